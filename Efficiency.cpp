@@ -0,0 +1,45 @@
+//
+//  Efficiency.cpp
+//  CloudSim
+//
+
+#include <algorithm>
+
+#include "Efficiency.hpp"
+
+void EfficiencyModel::Init() {
+    unsigned total = Machine_GetTotal();
+    classes.clear();
+    class_of.assign(total, 0);
+    for(MachineId_t machine_id = 0; machine_id < total; machine_id++) {
+        const MachineClassInfo_t & info = Machine_GetClassInfo(machine_id);
+        class_of[machine_id] = info.machine_class;
+        // Classes are numbered in the order of their first machine
+        if(info.machine_class < classes.size()) {
+            continue;
+        }
+        Class_t entry;
+        entry.idle_power = info.s_states[S0] + info.num_cpus * info.c_states[C1];
+        for(unsigned p = 0; p < P_STATES; p++) {
+            entry.busy_power[p] = info.s_states[S0] + info.num_cpus * info.p_states[p];
+            entry.mips_per_watt[p] = entry.busy_power[p] == 0 ? 0.0 : double(info.num_cpus) * info.performance[p] / entry.busy_power[p];
+            unsigned core_power = info.p_states[p] > info.c_states[C1] ? info.p_states[p] - info.c_states[C1] : 0;
+            entry.core_mips_per_watt[p] = core_power == 0 ? double(info.performance[p]) : double(info.performance[p]) / core_power;
+        }
+        for(unsigned s = 0; s < S_STATES; s++) {
+            entry.sleep_power[s] = info.s_states[s];
+        }
+        classes.push_back(entry);
+    }
+    order.resize(total);
+    for(MachineId_t machine_id = 0; machine_id < total; machine_id++) {
+        order[machine_id] = machine_id;
+    }
+    stable_sort(order.begin(), order.end(), [this](MachineId_t a, MachineId_t b) {
+        return MIPSPerWatt(a, P0) > MIPSPerWatt(b, P0);
+    });
+    rank.assign(total, 0);
+    for(unsigned i = 0; i < total; i++) {
+        rank[order[i]] = i;
+    }
+}
@@ -0,0 +1,48 @@
+//
+//  Efficiency.hpp
+//  CloudSim
+//
+
+#ifndef Efficiency_hpp
+#define Efficiency_hpp
+
+#include <vector>
+
+#include "Interfaces.h"
+
+// Energy efficiency of every machine class, computed once from the power and MIPS tables
+// of the class (see Machine_GetClassInfo()), and every query is a lookup in the table of
+// the machine's class.
+//
+// A machine is ranked by the MIPS per watt it delivers with all cores busy at P0, which
+// charges the S0 draw of the machine as well as the power of the cores.
+class EfficiencyModel {
+public:
+    void            Init();
+    unsigned        BusyPower(MachineId_t machine_id, CPUPerformance_t p_state) const  { return Class(machine_id).busy_power[p_state]; }
+    unsigned        ClassOf(MachineId_t machine_id) const                               { return class_of[machine_id]; }
+    unsigned        Classes() const                                                     { return unsigned(classes.size()); }
+    double          CoreMIPSPerWatt(MachineId_t machine_id, CPUPerformance_t p_state) const { return Class(machine_id).core_mips_per_watt[p_state]; }
+    unsigned        IdlePower(MachineId_t machine_id) const                             { return Class(machine_id).idle_power; }
+    double          MIPSPerWatt(MachineId_t machine_id, CPUPerformance_t p_state) const { return Class(machine_id).mips_per_watt[p_state]; }
+    const vector<MachineId_t> & Order() const                                          { return order; }
+    unsigned        Rank(MachineId_t machine_id) const                                  { return rank[machine_id]; }
+    unsigned        SleepPower(MachineId_t machine_id, MachineState_t s_state) const    { return Class(machine_id).sleep_power[s_state]; }
+private:
+    typedef struct {
+        unsigned    busy_power[P_STATES];           // S0 draw plus every core running at the P-state
+        double      core_mips_per_watt[P_STATES];   // What one more busy core adds, for a machine that is already up
+        unsigned    idle_power;                     // S0 draw with every core idle in C1
+        double      mips_per_watt[P_STATES];        // All cores busy
+        unsigned    sleep_power[S_STATES];          // Machine draw in each S-state
+    } Class_t;
+
+    const Class_t & Class(MachineId_t machine_id) const                                 { return classes[class_of[machine_id]]; }
+
+    vector<Class_t> classes;
+    vector<unsigned> class_of;
+    vector<unsigned> rank;                          // 0 is the most efficient machine
+    vector<MachineId_t> order;                      // Machines by rank
+};
+
+#endif /* Efficiency_hpp */
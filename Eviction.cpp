@@ -0,0 +1,54 @@
+//
+//  Eviction.cpp
+//  CloudSim
+//
+
+#include <algorithm>
+#include <stdint.h>
+
+#include "Eviction.hpp"
+
+vector<VMId_t> PlanEviction(vector<EvictionCandidate_t> candidates, unsigned overflow) {
+    sort(candidates.begin(), candidates.end(), [](const EvictionCandidate_t & a, const EvictionCandidate_t & b) {
+        return a.memory * b.cost > b.memory * a.cost;
+    });
+    vector<EvictionCandidate_t> picked;
+    uint64_t freed = 0;
+    for(const EvictionCandidate_t & candidate : candidates) {
+        if(freed >= overflow) {
+            break;
+        }
+        picked.push_back(candidate);
+        freed += candidate.memory;
+    }
+    vector<VMId_t> plan;
+    if(freed < overflow) {
+        for(const EvictionCandidate_t & candidate : picked) {
+            plan.push_back(candidate.vm_id);
+        }
+        return plan;
+    }
+    // The last picks may cover for some of the earlier ones
+    sort(picked.begin(), picked.end(), [](const EvictionCandidate_t & a, const EvictionCandidate_t & b) {
+        return a.cost > b.cost;
+    });
+    double cost = 0.0;
+    for(const EvictionCandidate_t & candidate : picked) {
+        if(freed - candidate.memory >= overflow) {
+            freed -= candidate.memory;
+            continue;
+        }
+        plan.push_back(candidate.vm_id);
+        cost += candidate.cost;
+    }
+    const EvictionCandidate_t * single = nullptr;
+    for(const EvictionCandidate_t & candidate : candidates) {
+        if(candidate.memory >= overflow && candidate.cost < (single == nullptr ? cost : single->cost)) {
+            single = &candidate;
+        }
+    }
+    if(single != nullptr) {
+        plan.assign(1, single->vm_id);
+    }
+    return plan;
+}
@@ -0,0 +1,29 @@
+//
+//  Eviction.hpp
+//  CloudSim
+//
+
+#ifndef Eviction_hpp
+#define Eviction_hpp
+
+#include <vector>
+
+#include "Interfaces.h"
+
+typedef struct {
+    VMId_t      vm_id;
+    unsigned    memory;         // Memory freed on the machine by moving the VM away
+    double      cost;           // Of moving the VM, greater than 0
+} EvictionCandidate_t;
+
+// Chooses the VMs to move off an overcommitted machine: a set of candidates that frees
+// at least the overflow for as little cost as it can find. That is a covering knapsack,
+// which is answered greedily in O(n log n) however many VMs the machine holds.
+// Candidates are taken by memory freed per unit of cost until the overflow is covered,
+// picks that turn out not to be needed are dropped again, the most expensive first, and
+// a single candidate that covers the overflow on its own wins if it is cheaper still.
+//
+// When all candidates together do not cover the overflow, all of them are returned.
+vector<VMId_t>      PlanEviction(vector<EvictionCandidate_t> candidates, unsigned overflow);
+
+#endif /* Eviction_hpp */
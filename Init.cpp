@@ -0,0 +1,208 @@
+//
+//  Init.cpp
+//  CloudSim
+//
+//  Created by ELMOOTAZBELLAH ELNOZAHY on 10/20/24.
+//
+
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Interfaces.h"
+#include "Internal_Interfaces.h"
+
+// The input file is a sequence of "machine class:" and "task class:" headers, each
+// followed by a { } block of "keyword: value" lines. Lines starting with # are comments.
+
+static void CleanUpString(string & s) {
+    s.erase(0, s.find_first_not_of(" \t\r\n"));
+    s.erase(s.find_last_not_of(" \t\r\n") + 1);
+}
+
+static vector<unsigned> ConvertBracketedStringToValues(string s) {
+    CleanUpString(s);
+    if(s.empty() || s.front() != '[' || s.back() != ']') {
+        ThrowException("ConvertBracketedStringToValues(): Invalid format. Expected '[' at the start and ']' at the end.");
+    }
+    istringstream ss(s.substr(1, s.length() - 2));
+    string item;
+    vector<unsigned> values;
+    while(getline(ss, item, ',')) {
+        CleanUpString(item);
+        if(!item.empty()) {
+            istringstream is(item);
+            unsigned value = 0;
+            is >> value;
+            values.push_back(value);
+        }
+    }
+    return values;
+}
+
+static string CheckAndGetString(map<string, string> & params, string key, string err_msg) {
+    auto it = params.find(key);
+    if(it == params.end()) {
+        ThrowException(err_msg);
+    }
+    return it->second;
+}
+
+static vector<unsigned> CheckAndGetVector(map<string, string> & params, string key, string err_msg) {
+    return ConvertBracketedStringToValues(CheckAndGetString(params, key, err_msg));
+}
+
+static uint64_t CheckAndGetLongValue(map<string, string> & params, string key, string err_msg) {
+    istringstream ss(CheckAndGetString(params, key, err_msg));
+    uint64_t value = 0;
+    ss >> value;
+    return value;
+}
+
+static unsigned CheckAndGetValue(map<string, string> & params, string key, string err_msg) {
+    istringstream ss(CheckAndGetString(params, key, err_msg));
+    unsigned value = 0;
+    ss >> value;
+    return value;
+}
+
+static unsigned MapNameToType(string name) {
+    static const unordered_map<string, unsigned> types = {
+        {"AI", AI_TRAINING}, {"CRYPTO", CRYPTO}, {"HPC", SCIENTIFIC}, {"STREAM", STREAMING}, {"WEB", WEB_REQUEST},
+        {"SLA0", SLA0}, {"SLA1", SLA1}, {"SLA2", SLA2}, {"SLA3", SLA3},
+        {"LINUX", LINUX}, {"LINUX_RT", LINUX_RT}, {"WIN", WIN}, {"AIX", AIX},
+        {"ARM", ARM}, {"X86", X86}, {"RISCV", RISCV}, {"POWER", POWER},
+        {"yes", 1}, {"no", 0}
+    };
+    auto it = types.find(name);
+    if(it == types.end()) {
+        ThrowException("MapNameToType(): Failed to map string " + name + " while reading input file.");
+    }
+    return it->second;
+}
+
+static void Parse(ifstream & input, map<string, string> & params) {
+    string line;
+    bool opened = false;
+    bool closed = false;
+    while(getline(input, line)) {
+        CleanUpString(line);
+        if(line.empty() || line[0] == '#') {
+            continue;
+        }
+        if(!opened) {
+            if(line == "{") {
+                opened = true;
+                continue;
+            }
+            ThrowException("Parse(): Parsing error while reading task parameters: Expected { but found\n ", line);
+        }
+        if(line == "}") {
+            closed = true;
+            break;
+        }
+        istringstream ss(line);
+        string key, value;
+        if(getline(ss, key, ':') && getline(ss, value)) {
+            CleanUpString(key);
+            CleanUpString(value);
+            params[key] = value;
+        }
+        else {
+            ThrowException("Parse(): Parsing error while reading input: Expected 'keyword: value' but found\n ", line);
+        }
+    }
+    if(!closed) {
+        ThrowException("Parse(): Parsing error while reading input: Expected } but found\n ", line);
+    }
+}
+
+static void ReadMachineClass(ifstream & input) {
+    SimOutput("ReadMachineClass(): Reading machine descriptor", 1);
+    map<string, string> params;
+    Parse(input, params);
+
+    unsigned memory = CheckAndGetValue(params, "Memory", "Failed: No memory requirement for machine class");
+    unsigned cores = CheckAndGetValue(params, "Number of cores", "Failed: No core specified for machine class");
+    unsigned machines = CheckAndGetValue(params, "Number of machines", "Failed: No number of machines for machine class");
+    bool gpu = MapNameToType(CheckAndGetString(params, "GPUs", "Failed: No GPU flag for machine class"));
+    vector<unsigned> s_states = CheckAndGetVector(params, "S-States", "Failed: Could not read s states for machine class");
+    vector<unsigned> p_states = CheckAndGetVector(params, "P-States", "Failed: Could not read p states for machine class");
+    vector<unsigned> c_states = CheckAndGetVector(params, "C-States", "Failed: Could not read c states for machine class");
+    vector<unsigned> mips = CheckAndGetVector(params, "MIPS", "Failed: Could not read MIPS for machine class");
+    CPUType_t cpu = CPUType_t(MapNameToType(CheckAndGetString(params, "CPU type", "Failed: No CPU type for machine class")));
+
+    for(unsigned i = 0; i < machines; i++) {
+        Machine_Add(memory, cores, s_states, c_states, p_states, mips, gpu, cpu);
+    }
+}
+
+static void ReadTaskClass(ifstream & input) {
+    SimOutput("ReadTaskClass(): Reading task descriptor", 1);
+    map<string, string> params;
+    Parse(input, params);
+
+    Time_t start = CheckAndGetLongValue(params, "Start time", "Failed: No starting time for the task class");
+    Time_t end = CheckAndGetLongValue(params, "End time", "Failed: No ending time for the task class");
+    Time_t inter_arrival = CheckAndGetLongValue(params, "Inter arrival", "Failed: No inter arrival time for task class");
+    uint64_t runtime = CheckAndGetLongValue(params, "Expected runtime", "Failed: No estimated runtime for task class");
+    TaskClass_t task_class = TaskClass_t(MapNameToType(CheckAndGetString(params, "Task type", "Failed: No type for task class")));
+    CPUType_t cpu = CPUType_t(MapNameToType(CheckAndGetString(params, "CPU type", "Failed: No CPU type for task class")));
+    SLAType_t sla = SLAType_t(MapNameToType(CheckAndGetString(params, "SLA type", "Failed: No SLA for task class")));
+    VMType_t vm = VMType_t(MapNameToType(CheckAndGetString(params, "VM type", "Failed: No VM type for task class")));
+    unsigned memory = CheckAndGetValue(params, "Memory", "Failed: No memory requirement for task class");
+    unsigned seed = CheckAndGetValue(params, "Seed", "Failed: No seed for task class");
+    bool gpu = MapNameToType(CheckAndGetString(params, "GPU enabled", "Failed: No GPU flag for task class")) != 0;
+
+    // Arrivals are a Poisson process (inter arrival in ms), runtimes are uniform around
+    // the expected runtime with a standard deviation of 20%, and the SLA class sets how
+    // much slack the target completion time gets on top of the runtime.
+    uint64_t deviation = runtime / 5;
+    uint64_t slack = sla == SLA0 ? 3 : sla == SLA1 ? 8 : 12;
+    Time_t target_slack = runtime * slack;
+    exponential_distribution<double> arrival_distribution(1000.0 / double(inter_arrival));
+    double half_width = double(deviation) * 3.4641016151377544 / 2.0;      // sqrt(12) / 2
+    uniform_real_distribution<double> runtime_distribution(double(runtime) - half_width, double(runtime) + half_width);
+    mt19937 generator(seed);
+
+    for(Time_t arrival = start; arrival < end; ) {
+        arrival += Time_t(arrival_distribution(generator) * 1000.0);
+        unsigned task_runtime = unsigned(runtime_distribution(generator));
+        Time_t target = arrival + target_slack + task_runtime;
+        uint64_t instructions = task_runtime * 1000;
+        TaskId_t task_id = AddTask(instructions, arrival, target, vm, sla, cpu, gpu, memory, task_class);
+        SimOutput("ReadTaskClass(): Task " + to_string(task_id) + " with " + to_string(instructions) + " instructions added at " + to_string(arrival), 1);
+    }
+}
+
+static void ReadInput(string filename) {
+    ifstream input(filename);
+    if(!input.is_open()) {
+        ThrowException("ReadInput(): Could not input file ", filename);
+    }
+    string line;
+    while(getline(input, line)) {
+        if(line == "machine class:") {
+            ReadMachineClass(input);
+        }
+        else if(line == "task class:") {
+            ReadTaskClass(input);
+        }
+    }
+    input.close();
+}
+
+void Init(string filename) {
+    SimOutput("Init(): About to read input file", 1);
+    ReadInput(filename);
+    SimOutput("Init(): Found " + to_string(GetNumTasks()) + " tasks", 1);
+    SimOutput("Init(): Found " + to_string(Machine_GetTotal()) + " machines", 1);
+    SimOutput("Init(): About to initialize scheduler", 1);
+    InitScheduler();
+    SimOutput("Init(): Starting simulation", 1);
+    StartSimulation();
+}
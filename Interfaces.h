@@ -20,8 +20,13 @@
 
 #include "SimTypes.h"
 
+// The *Ref queries return a view of the simulator's own record instead of a copy. A view
+// stays valid for the rest of the run, but its contents change as the simulation moves on,
+// so copy out anything that must survive a call that attaches, removes or migrates work.
+
 // Debugging Interface
 extern void             SimOutput(string msg, unsigned verbose_level);
+extern bool             SimVerbose(unsigned verbose_level);                    // Whether SimOutput() prints at this level
 extern void             ThrowException(string err_msg);
 extern void             ThrowException(string err_msg, string further_input);
 extern void             ThrowException(string err_msg, unsigned further_input);
@@ -31,23 +36,32 @@ extern CPUType_t        Machine_GetCPUType(MachineId_t machine_id);
 extern uint64_t         Machine_GetEnergy(MachineId_t machine_id);
 extern double           Machine_GetClusterEnergy();
 extern MachineInfo_t    Machine_GetInfo(MachineId_t machine_id);
+extern const MachineInfo_t & Machine_GetInfoRef(MachineId_t machine_id);
+extern const MachineClassInfo_t & Machine_GetClassInfo(MachineId_t machine_id); // The power and MIPS tables, shared by the machines of a class
+extern unsigned         Machine_GetActiveTasks(MachineId_t machine_id);
+extern unsigned         Machine_GetActiveVMs(MachineId_t machine_id);
+extern unsigned         Machine_GetFreeMemory(MachineId_t machine_id);          // Memory not yet committed, 0 when overcommitted
 extern unsigned         Machine_GetTotal();
 extern void             Machine_SetCorePerformance(MachineId_t machine_id, unsigned core_id, CPUPerformance_t p_state);  // This is oriented toward dynamic energy
 extern void             Machine_SetState(MachineId_t machine_id, MachineState_t s_state);
 
 // Scheduler Interface
 extern void             InitScheduler();                                    // Called once at the beginning
-extern void             HandleNewTask(Time_t time, TaskId_t task_id);       // Called every time a new task arrives to the system
+extern void             HandleNewTasks(Time_t time, const vector<TaskId_t> & task_ids); // Called with the tasks that arrive at time (see CLOUDSIM_ARRIVAL_WINDOW)
 extern void             HandleTaskCompletion(Time_t time, TaskId_t task_id);// Called whenver a task finishes
+extern void             MachineDeltas(Time_t time, const vector<MachineDelta_t> & deltas);  // Called after each simulator event with the machines whose memory, tasks, VMs or S state changed
 extern void             MemoryWarning(Time_t time, MachineId_t machine_id); // Called to alert the scheduler of memory overcommitment
 extern void             MigrationDone(Time_t time, VMId_t vm_id);           // Called to alert the scheduler that the VM has been migrated successfully
 extern void             SchedulerCheck(Time_t time);                        // Called periodically. You may want to do some monitoring and adjustments
 extern void             SimulationComplete(Time_t time);                    // Called at the end of the simulation
+extern void             SimulationForked(Time_t time, unsigned variant);    // Called in every copy of a run forked at time (see CLOUDSIM_FORK_AT), variant 0 is the original
 extern void             SLAWarning(Time_t time, TaskId_t task_id);          // Called to alert the schedule of an SLA violation
 extern void             StateChangeComplete(Time_t time, MachineId_t machine_id);   // Called in response to an earlier request to change the state of a machine
 
 // Statistics
 extern double           GetSLAReport(SLAType_t sla);
+extern WindowReport_t   GetWindowReport();                                  // The last CLOUDSIM_WINDOW us, as of the last eighth of it that ended
+extern vector<WindowReport_t> GetWorstWindows();                            // The windows with the most SLA0-2 violations, worst first, not overlapping
 
 // Simulator Interface
 extern Time_t           Now();
@@ -55,6 +69,7 @@ extern Time_t           Now();
 // Task Interface
 extern unsigned         GetNumTasks();
 extern TaskInfo_t       GetTaskInfo(TaskId_t task_id);
+extern const TaskInfo_t & GetTaskInfoRef(TaskId_t task_id);
 extern unsigned         GetTaskMemory(TaskId_t task_id);
 extern unsigned         GetTaskPriority(TaskId_t task_id);
 extern bool             IsSLAViolated(TaskId_t task_id);
@@ -70,6 +85,9 @@ extern void             VM_Attach(VMId_t vm_id, MachineId_t machine_id);
 extern void             VM_AddTask(VMId_t vm_id, TaskId_t task_id, Priority_t priority);
 extern VMId_t           VM_Create(VMType_t vm_type, CPUType_t cpu);
 extern VMInfo_t         VM_GetInfo(VMId_t vm_id);
+extern const VMInfo_t & VM_GetInfoRef(VMId_t vm_id);
+extern unsigned         VM_GetMemoryFootprint(VMId_t vm_id);                    // VM_MEMORY_OVERHEAD plus the memory of its tasks
+extern unsigned         VM_GetTaskCount(VMId_t vm_id);
 extern void             VM_Migrate(VMId_t vm_id, MachineId_t machine_id);
 extern void             VM_RemoveTask(VMId_t vm_id, TaskId_t task_id);
 extern void             VM_Shutdown(VMId_t vm_id);
@@ -35,6 +35,10 @@ extern void Machine_DetachVM(MachineId_t machine_id, VMId_t vm_id);
 extern void Machine_AttachTask(MachineId_t machine_id, TaskId_t task_id, VMId_t vm_id);
 extern void Machine_HandleTimer(Time_t time);
 extern void Machine_MigrateVM(VMId_t vm_id, MachineId_t current, MachineId_t next);
+extern void Machine_ReportDeltas(Time_t time);
+extern void Machine_SettleTask(TaskId_t task_id);                      // Charges a coasting task for the quanta it ran through
+extern void Machine_StartWorkers(unsigned workers);
+extern unsigned Machine_StopWorkers();                  // Returns how many worker threads were running
 
 // Internal Simulator Interface
 extern void StartSimulation();
@@ -49,7 +53,35 @@ extern TaskId_t AddTask(uint64_t inst, Time_t arr, Time_t trgt, VMType_t vm, SLA
 extern void CompleteTask(TaskId_t task_id);
 extern unsigned GetActiveTasks();
 extern uint64_t GetRemainingInstructions(TaskId_t task_id);
+extern unsigned GetSLACompleted(SLAType_t sla);
+extern unsigned GetSLAViolations(SLAType_t sla);
 extern void SetRemainingInstructions(TaskId_t task_id, uint64_t instructions);
+extern void SetTaskCoasting(TaskId_t task_id, bool coasting);              // Reads of the task settle it through Machine_SettleTask() first
+
+// Metrics interface
+extern void Metrics_Start();
+extern void Metrics_Power(uint64_t power);                              // The cluster's power draw changed
+extern void Metrics_SState(MachineState_t from, MachineState_t to);
+extern void Metrics_TaskCompleted(SLAType_t sla, bool violated);
+
+// Telemetry interface
+extern void Telemetry_Start();
+extern void Telemetry_Sample(Time_t time);
+extern void Telemetry_Suspend();                        // Around a fork, the writer thread would not survive it
+extern void Telemetry_Resume(unsigned variant);         // A forked variant records to a file of its own
+extern void Telemetry_Stop();
+
+// Trace interface
+extern void Trace_Start();
+extern void Trace_Suspend();                            // Before a fork, so that buffered events are written once
+extern void Trace_Resume(unsigned variant);             // A forked variant traces to a file of its own
+extern void Trace_Stop();
+extern void Trace_MigrationCompleted(VMId_t vm_id, MachineId_t machine_id);
+extern void Trace_MigrationStarted(VMId_t vm_id, MachineId_t machine_id);
+extern void Trace_PState(MachineId_t machine_id, CPUPerformance_t p_state);
+extern void Trace_SState(MachineId_t machine_id, MachineState_t s_state);
+extern void Trace_TaskAttached(TaskId_t task_id, VMId_t vm_id, MachineId_t machine_id);
+extern void Trace_TaskCompleted(TaskId_t task_id, bool violated);
 
 // Internal VM Interface
 extern bool VM_IsPendingMigration(VMId_t vm_id);
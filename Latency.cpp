@@ -0,0 +1,101 @@
+//
+//  Latency.cpp
+//  CloudSim
+//
+
+#include <iostream>
+#include <stdio.h>
+
+#include "Latency.hpp"
+
+static const double PERCENTILES[] = {50.0, 90.0, 99.0, 99.9};
+static const char * CLASS_NAMES[NUM_TASK_CLASSES] = {"AI_TRAINING", "CRYPTO", "SCIENTIFIC", "STREAMING", "WEB_REQUEST"};
+static const char * SLA_NAMES[NUM_SLAS] = {"SLA0", "SLA1", "SLA2", "SLA3"};
+
+unsigned LatencyHistogram::Index(uint64_t value) {
+    if(value < SUB_BUCKETS) {
+        return unsigned(value);
+    }
+    unsigned top = 63 - unsigned(__builtin_clzll(value));
+    if(top >= MAX_BITS) {
+        return BUCKETS - 1;
+    }
+    unsigned shift = top - SUB_BITS + 1;
+    return SUB_BUCKETS + (shift - 1) * (SUB_BUCKETS / 2) + unsigned(value >> shift) - SUB_BUCKETS / 2;
+}
+
+uint64_t LatencyHistogram::Highest(unsigned index) {
+    if(index < SUB_BUCKETS) {
+        return index;
+    }
+    unsigned shift = (index - SUB_BUCKETS) / (SUB_BUCKETS / 2) + 1;
+    uint64_t sub = (index - SUB_BUCKETS) % (SUB_BUCKETS / 2) + SUB_BUCKETS / 2;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+    counts[Index(value)]++;
+    count++;
+}
+
+uint64_t LatencyHistogram::Percentile(double percent) const {
+    uint64_t rank = uint64_t(percent / 100.0 * count + 0.5);
+    rank = rank == 0 ? 1 : rank;
+    uint64_t seen = 0;
+    for(unsigned index = 0; index < BUCKETS; index++) {
+        seen += counts[index];
+        if(seen >= rank) {
+            return Highest(index);
+        }
+    }
+    return Highest(BUCKETS - 1);
+}
+
+void LatencyStats::TaskCompleted(TaskId_t task_id) {
+    const TaskInfo_t & task = GetTaskInfoRef(task_id);
+    uint64_t latency = task.completion - task.arrival;
+    slas[task.required_sla].latency.Record(latency);
+    classes[task.task_class].latency.Record(latency);
+    if(task.target_completion > task.arrival) {
+        uint64_t stretch = latency * 1000 / (task.target_completion - task.arrival);
+        slas[task.required_sla].stretch.Record(stretch);
+        classes[task.task_class].stretch.Record(stretch);
+    }
+}
+
+void LatencyStats::Print(const char * name, const Histograms_t & histograms) {
+    char line[256];
+    int length = snprintf(line, sizeof(line), "%-12s %8llu  stretch", name, (unsigned long long)(histograms.latency.Count()));
+    for(double percent : PERCENTILES) {
+        length += snprintf(line + length, sizeof(line) - length, " %7.3f", histograms.stretch.Percentile(percent) / 1000.0);
+    }
+    length += snprintf(line + length, sizeof(line) - length, "  latency");
+    for(double percent : PERCENTILES) {
+        length += snprintf(line + length, sizeof(line) - length, " %9.3f", histograms.latency.Percentile(percent) / 1000000.0);
+    }
+    cout << line << endl;
+}
+
+void LatencyStats::Report() const {
+    cout << "Completion report, stretch and latency (s) at p50 p90 p99 p99.9" << endl;
+    for(unsigned sla = 0; sla < NUM_SLAS; sla++) {
+        if(slas[sla].latency.Count() > 0) {
+            Print(SLA_NAMES[sla], slas[sla]);
+        }
+    }
+    for(unsigned task_class = 0; task_class < NUM_TASK_CLASSES; task_class++) {
+        if(classes[task_class].latency.Count() > 0) {
+            Print(CLASS_NAMES[task_class], classes[task_class]);
+        }
+    }
+    cout << "Worst windows, violations/completions of SLA0-2, energy and average awake machines" << endl;
+    for(const WindowReport_t & window : GetWorstWindows()) {
+        char line[256];
+        int length = snprintf(line, sizeof(line), "%10.3fs - %10.3fs ", window.start / 1000000.0, window.end / 1000000.0);
+        for(unsigned sla = SLA0; sla < SLA3; sla++) {
+            length += snprintf(line + length, sizeof(line) - length, " %s %u/%u", SLA_NAMES[sla], window.violations[sla], window.completed[sla]);
+        }
+        snprintf(line + length, sizeof(line) - length, "  %.6fKW-Hour  %.1f awake", window.energy, window.awake_hosts);
+        cout << line << endl;
+    }
+}
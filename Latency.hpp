@@ -0,0 +1,59 @@
+//
+//  Latency.hpp
+//  CloudSim
+//
+
+#ifndef Latency_hpp
+#define Latency_hpp
+
+#include <stdint.h>
+
+#include "Interfaces.h"
+
+#define NUM_TASK_CLASSES    5           // AI_TRAINING to WEB_REQUEST
+
+// Log-bucketed histogram in the manner of HdrHistogram. Values below SUB_BUCKETS have a
+// bucket each, and every power of two above that is split into SUB_BUCKETS / 2 buckets,
+// so a value is known to within 1 / 64 of itself whatever its size. Values past
+// 2^MAX_BITS land in the last bucket. The counts are a fixed array, so recording is a
+// shift and an increment and a histogram never grows.
+class LatencyHistogram {
+public:
+    void            Record(uint64_t value);
+    uint64_t        Count() const                               { return count; }
+    uint64_t        Percentile(double percent) const;           // The highest value of the bucket it falls in
+private:
+    static const unsigned SUB_BITS = 7;
+    static const unsigned SUB_BUCKETS = 1 << SUB_BITS;
+    static const unsigned MAX_BITS = 48;
+    static const unsigned BUCKETS = SUB_BUCKETS + (MAX_BITS - SUB_BITS) * SUB_BUCKETS / 2;
+
+    static unsigned Index(uint64_t value);
+    static uint64_t Highest(unsigned index);
+
+    uint64_t        count = 0;
+    uint32_t        counts[BUCKETS] = {};
+};
+
+// Completion statistics by SLA and by task class: the stretch of a task, its time from
+// arrival to completion over the time its target allowed, and that latency itself.
+// Stretch is kept in thousandths and latency in us. Report() prints p50, p90, p99 and
+// p99.9 of both for every SLA and class that saw a completion, and then the windows of
+// the run with the most SLA violations (see GetWorstWindows()).
+class LatencyStats {
+public:
+    void            TaskCompleted(TaskId_t task_id);
+    void            Report() const;
+private:
+    typedef struct {
+        LatencyHistogram stretch;
+        LatencyHistogram latency;
+    } Histograms_t;
+
+    static void     Print(const char * name, const Histograms_t & histograms);
+
+    Histograms_t    slas[NUM_SLAS];
+    Histograms_t    classes[NUM_TASK_CLASSES];
+};
+
+#endif /* Latency_hpp */
@@ -0,0 +1,160 @@
+//
+//  LoadModel.hpp
+//  CloudSim
+//
+
+#ifndef LoadModel_hpp
+#define LoadModel_hpp
+
+#include <stdint.h>
+#include <vector>
+
+#include "Interfaces.h"
+
+#define NEVER UINT64_MAX    // Finish time of a task that gets no CPU time
+
+// Predicts how fast the tasks on a machine run. The machine time shares its cores every
+// quantum: the queued tasks are dispatched in priority order, one per core, and the
+// tasks of a priority level that does not get a core for each take turns. A task at a
+// level with k tasks and c cores left over by the levels above it runs c / k of the
+// time (all of it when k <= c, none when c is 0), at performance[p_state] instructions
+// per microsecond, slowed down by memory overcommitment and sped up by the GPU if both
+// the task and the machine have one.
+//
+// The scheduler reports where its tasks run and at which priority, and the model keeps
+// per machine task counts by priority, so every query costs O(PRIORITY_LEVELS). Finish
+// times are based on the instructions the task had left when its current quantum began.
+class LoadModel {
+public:
+    void            Init();
+    void            PriorityChanged(TaskId_t task_id, Priority_t priority);
+    void            TaskAdded(TaskId_t task_id, MachineId_t machine_id);
+    void            TaskRemoved(TaskId_t task_id);
+    void            VMMoved(VMId_t vm_id, MachineId_t machine_id);
+
+    Time_t          FinishTime(TaskId_t task_id, Time_t now) const;
+    double          HostMIPS(MachineId_t machine_id, Priority_t priority, bool gpu_capable) const;
+    Time_t          PredictFinish(TaskId_t task_id, MachineId_t machine_id, Time_t now) const;
+    Time_t          PredictFinish(TaskId_t task_id, MachineId_t machine_id, Priority_t priority, Time_t now) const;
+    double          TaskMIPS(TaskId_t task_id) const;
+    unsigned        Tasks(MachineId_t machine_id, Priority_t priority) const    { return hosts[machine_id].tasks[priority]; }
+private:
+    typedef struct {
+        unsigned    tasks[PRIORITY_LEVELS];
+    } Host_t;
+    typedef struct {
+        bool        placed;
+        MachineId_t machine_id;
+        Priority_t  priority;
+    } Resident_t;
+
+    static Time_t   Finish(uint64_t instructions, double mips, Time_t now);
+    double          Rate(MachineId_t machine_id, Priority_t priority, bool gpu_capable, unsigned newcomers) const;
+
+    vector<Host_t>  hosts;
+    vector<Resident_t> residents;   // Indexed by task id
+};
+
+inline void LoadModel::Init() {
+    hosts.assign(Machine_GetTotal(), Host_t());
+    residents.assign(GetNumTasks(), {false, 0, MID_PRIORITY});
+}
+
+// Call after SetTaskPriority() on a task the model knows about
+inline void LoadModel::PriorityChanged(TaskId_t task_id, Priority_t priority) {
+    Resident_t & resident = residents[task_id];
+    if(resident.placed) {
+        hosts[resident.machine_id].tasks[resident.priority]--;
+        hosts[resident.machine_id].tasks[priority]++;
+    }
+    resident.priority = priority;
+}
+
+// Call after VM_AddTask(), which sets the priority the task runs at
+inline void LoadModel::TaskAdded(TaskId_t task_id, MachineId_t machine_id) {
+    TaskRemoved(task_id);
+    Resident_t & resident = residents[task_id];
+    resident.placed = true;
+    resident.machine_id = machine_id;
+    resident.priority = GetTaskInfoRef(task_id).priority;
+    hosts[machine_id].tasks[resident.priority]++;
+}
+
+inline void LoadModel::TaskRemoved(TaskId_t task_id) {
+    Resident_t & resident = residents[task_id];
+    if(resident.placed) {
+        hosts[resident.machine_id].tasks[resident.priority]--;
+        resident.placed = false;
+    }
+}
+
+// The tasks of a VM stay on the source machine while it migrates
+inline void LoadModel::VMMoved(VMId_t vm_id, MachineId_t machine_id) {
+    for(TaskId_t task_id : VM_GetInfoRef(vm_id).active_tasks) {
+        TaskAdded(task_id, machine_id);
+    }
+}
+
+inline Time_t LoadModel::Finish(uint64_t instructions, double mips, Time_t now) {
+    if(instructions == 0) {
+        return now;
+    }
+    if(mips <= 0.0) {
+        return NEVER;
+    }
+    return now + Time_t(double(instructions) / mips);
+}
+
+inline double LoadModel::Rate(MachineId_t machine_id, Priority_t priority, bool gpu_capable, unsigned newcomers) const {
+    const MachineInfo_t & info = Machine_GetInfoRef(machine_id);
+    if(info.s_state != S0) {
+        return 0.0;
+    }
+    const Host_t & host = hosts[machine_id];
+    unsigned cores = info.num_cpus;
+    for(unsigned level = 0; level < unsigned(priority) && cores > 0; level++) {
+        cores -= host.tasks[level] < cores ? host.tasks[level] : cores;
+    }
+    unsigned sharing = host.tasks[priority] + newcomers;
+    double share = sharing <= cores ? 1.0 : double(cores) / double(sharing);
+    unsigned slowdown = info.memory_used <= info.memory_size ? NORMAL_SLOWDOWN
+                      : info.memory_used > 2 * info.memory_size ? THRASHING_SLOWDOWN : SWAPPING_SLOWDOWN;
+    double mips = double(Machine_GetClassInfo(machine_id).performance[info.p_state]) * NORMAL_SLOWDOWN / slowdown;
+    if(gpu_capable && info.gpus) {
+        mips *= GPU_SPEEDUP;
+    }
+    return mips * share;
+}
+
+// Expected completion time of a placed task if nothing changes on its machine
+inline Time_t LoadModel::FinishTime(TaskId_t task_id, Time_t now) const {
+    return Finish(GetTaskInfoRef(task_id).remaining_instructions, TaskMIPS(task_id), now);
+}
+
+// Instructions per microsecond a new task at the given priority would get on the machine
+inline double LoadModel::HostMIPS(MachineId_t machine_id, Priority_t priority, bool gpu_capable) const {
+    return Rate(machine_id, priority, gpu_capable, 1);
+}
+
+// Expected completion time of the task if it ran on the given machine from now on
+inline Time_t LoadModel::PredictFinish(TaskId_t task_id, MachineId_t machine_id, Time_t now) const {
+    return PredictFinish(task_id, machine_id, GetTaskInfoRef(task_id).priority, now);
+}
+
+// The same at another priority, e.g. to see what raising the priority of a task would do
+inline Time_t LoadModel::PredictFinish(TaskId_t task_id, MachineId_t machine_id, Priority_t priority, Time_t now) const {
+    const TaskInfo_t & task = GetTaskInfoRef(task_id);
+    const Resident_t & resident = residents[task_id];
+    bool resident_here = resident.placed && resident.machine_id == machine_id && resident.priority == priority;
+    return Finish(task.remaining_instructions, Rate(machine_id, priority, task.gpu_capable, resident_here ? 0 : 1), now);
+}
+
+inline double LoadModel::TaskMIPS(TaskId_t task_id) const {
+    const Resident_t & resident = residents[task_id];
+    if(!resident.placed) {
+        return 0.0;
+    }
+    return Rate(resident.machine_id, resident.priority, GetTaskInfoRef(task_id).gpu_capable, 0);
+}
+
+#endif /* LoadModel_hpp */
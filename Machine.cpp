@@ -0,0 +1,1246 @@
+//
+//  Machine.cpp
+//  CloudSim
+//
+//  Created by ELMOOTAZBELLAH ELNOZAHY on 10/20/24.
+//
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <queue>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Interfaces.h"
+#include "Internal_Interfaces.h"
+
+#define TIMER_PERIOD        60000       // Scheduling quantum, the cores are time shared at this granularity
+#define PARALLEL_TICK_MIN   16          // Smallest run of quiet machines worth handing to the workers
+
+// Energy is not integrated on the timer. Every machine keeps its current power draw
+// (S-state power plus the C/P-state power of each core) and advances its own energy
+// counter only when that draw changes or when somebody asks. The cluster keeps the
+// same kind of running total, so reporting the cluster energy is O(1).
+static uint64_t cluster_energy = 0;
+static uint64_t cluster_power = 0;
+static Time_t   cluster_energy_time = 0;
+
+// All machines share one timer, and the n-th tick of the timer moves every machine's
+// end of quantum to (n + 1) * TIMER_PERIOD. While a tick is being delivered, machines
+// that it has not reached yet are still in the previous quantum.
+static uint64_t timer_ticks = 0;
+static bool     timer_in_progress = false;
+static MachineId_t timer_cursor = 0;
+
+static void AdvanceClusterEnergy(Time_t now) {
+    cluster_energy += cluster_power * (now - cluster_energy_time);
+    cluster_energy_time = now;
+}
+
+// Everything a machine's tick does outside of the machine itself, recorded when the tick
+// runs on a worker thread and replayed on the simulator thread in machine order: trace
+// output, completion events and task progress, in the order they were produced, and the
+// change in the machine's power draw.
+typedef enum {
+    TICK_OUTPUT,
+    TICK_COMPLETION,
+    TICK_REMAINING
+} TickRecordType_t;
+
+typedef struct {
+    TickRecordType_t type;
+    string      msg;            // TICK_OUTPUT
+    unsigned    id;             // Verbosity level, core or task
+    uint64_t    value;          // Completion time or remaining instructions
+} TickRecord_t;
+
+typedef struct {
+    vector<TickRecord_t> records;
+    uint64_t    power_delta;
+    exception_ptr error;
+} TickLog_t;
+
+static thread_local TickLog_t * tick_log = nullptr;
+
+// Trace output is only formatted, and recorded by a worker, when the verbosity level
+// asks for it, so a tick builds no strings on a quiet run
+#define Output(msg, level) do { if(SimVerbose(level)) { Emit(msg, level); } } while(false)
+
+static void Emit(string msg, unsigned level) {
+    if(tick_log != nullptr) {
+        tick_log->records.push_back({TICK_OUTPUT, move(msg), level, 0});
+    }
+    else {
+        SimOutput(msg, level);
+    }
+}
+
+// The task table traces every update, so updates made by a worker wait in the log too
+static uint64_t GetTaskRemaining(TaskId_t task_id) {
+    if(tick_log != nullptr) {
+        auto & records = tick_log->records;
+        for(auto record = records.rbegin(); record != records.rend(); record++) {
+            if(record->type == TICK_REMAINING && record->id == task_id) {
+                return record->value;
+            }
+        }
+    }
+    return GetRemainingInstructions(task_id);
+}
+
+static void SetTaskRemaining(TaskId_t task_id, uint64_t instructions) {
+    if(tick_log != nullptr) {
+        tick_log->records.push_back({TICK_REMAINING, string(), task_id, instructions});
+    }
+    else {
+        SetRemainingInstructions(task_id, instructions);
+    }
+}
+
+typedef struct {
+    TaskId_t task_id;
+    VMId_t vm_id;
+} Job;
+
+// The power and MIPS tables are the same for every machine of a class, so they are kept
+// once per class and a machine only holds the index of its class. Machine_Add() interns
+// the class of each machine it adds, looking at the last class first since the machines
+// of a class are added one after the other.
+static vector<MachineClassInfo_t> Machine_classes;
+
+// A core charges its task for a whole quantum when the task is dispatched. A task that
+// the next tick would simply put back on the same core "coasts": the core remembers the
+// instruction count at dispatch and the cost of a full quantum, and the quanta it ran
+// through unattended are charged in one go by Settle() when somebody needs to look.
+class CPU {
+public:
+    CPU(MachineId_t machine_id, unsigned id, bool gpu) : gpu(gpu), id(id), machine_id(machine_id), instr_to_run(0), quantum_instr(0), remaining(0), quantum_end(0), projected_finish(0), c_state(C1), p_state(P0) {}
+    unsigned        GetId()                 { return id; }
+    Job             GetJob()                { return job; }
+    Time_t          GetProjectedFinish()    { return projected_finish; }
+    bool            IsBusy()                { return c_state == C0; }
+    bool            CompletesAt(Time_t quantum_end);
+    Time_t          NextWake();
+    void            SetCState(CPUState_t c_state);
+    void            SetPState(CPUPerformance_t p_state);
+    void            Settle(Time_t quantum_end);
+    void            TaskRun(Job & job, unsigned slowdown, Time_t next_timer);
+    void            TaskStop();
+private:
+    unsigned        Power();
+    void            ChangeState(CPUState_t c_state, CPUPerformance_t p_state);
+
+    bool            gpu;
+    unsigned        id;
+    MachineId_t     machine_id;
+    Job             job;
+    uint64_t        instr_to_run;       // Instructions charged for the current quantum
+    uint64_t        quantum_instr;      // Instructions charged for a full quantum at the dispatch rate
+    uint64_t        remaining;          // Instructions left in the task at dispatch
+    Time_t          quantum_end;        // End of the quantum the task was dispatched for
+    Time_t          projected_finish;
+    CPUState_t      c_state;
+    CPUPerformance_t p_state;
+};
+
+class Machine {
+public:
+    Machine(const MachineClassInfo_t & machine_class, MachineId_t id);
+    void            AttachVM(VMId_t vm_id);
+    void            ChangePower(unsigned from, unsigned to);
+    void            DetachVM(VMId_t vm_id);
+    uint64_t        GetEnergy();
+    const MachineInfo_t & GetInfo();
+    unsigned        GetActiveTasks()        { return info.active_tasks; }
+    unsigned        GetActiveVMs()          { return info.active_vms; }
+    unsigned        GetFreeMemory()         { return info.memory_used < info.memory_size ? info.memory_size - info.memory_used : 0; }
+    bool            TakeDelta(MachineDelta_t & delta);
+    CPUType_t       GetMachineCPUType()     { return info.cpu; }
+    const MachineClassInfo_t & GetClassInfo() { return Machine_classes[info.machine_class]; }
+    unsigned        GetCorePower(CPUState_t c_state, CPUPerformance_t p_state) { return c_state == C0 ? GetClassInfo().p_states[p_state] : GetClassInfo().c_states[c_state]; }
+    unsigned        GetMIPS(CPUPerformance_t p_state)                          { return GetClassInfo().performance[p_state]; }
+    void            HandleTimer();
+    bool            IsIdle();
+    bool            IsQuietTick();
+    bool            CanCoast();
+    void            Coast();
+    bool            IsReady()               { return info.s_state == S0; }
+    bool            MemoryOverflow()        { return info.memory_used > info.memory_size; }
+    void            Migrate(VMId_t vm_id);
+    void            SetPerformance(CPUPerformance_t p_state);
+    void            SetState(MachineState_t s_state);
+    void            SettleCurrent()         { Settle(NextTimer()); }
+    void            TaskAdd(TaskId_t task_id, VMId_t vm_id);
+    void            TaskFinish(unsigned core_id);
+    Time_t          NextWake();
+private:
+    void            MarkDirty();
+    Time_t          NextTimer();
+    void            NoteChange();
+    void            Settle(Time_t quantum_end);
+    void            SetNewState(MachineState_t s_state);
+    void            TaskRemove(TaskId_t task_id, VMId_t vm_id);
+    void            TaskRun(TaskId_t task_id, VMId_t vm_id, unsigned core_id);
+    void            UpdateMemory(int size);
+
+    queue<Job>      run_queue[PRIORITY_LEVELS];
+    vector<CPU>     cpus;
+    unsigned        slowdown;
+    bool            changing_state;
+    MachineState_t  target_state;
+    unsigned        state_countdown;    // Timer ticks left before the machine reaches target_state
+    bool            dirty;              // Changed since the last tick in a way the next tick must see
+    bool            delta_pending;      // Has an entry in pending_deltas
+    uint64_t        energy;
+    uint64_t        power;
+    Time_t          energy_time;
+    MachineInfo_t   info;
+};
+
+static vector<Machine> Machines;
+
+// Machines that changed since the last report, each with a copy of its memory, task and
+// VM counts and S state from before the first change. Machine_ReportDeltas() turns them
+// into deltas for the scheduler once the simulator event that made the changes is over.
+static vector<MachineDelta_t> pending_deltas;
+
+// One bit per machine that has something for the timer to do: a busy core, a queued
+// task or a pending S-state change. Machines outside the set skip the tick entirely.
+// A machine whose cores are all coasting leaves the set and waits in the wake queue
+// for the first tick at which one of its tasks completes.
+static vector<uint64_t> ticking;
+
+#define NOT_QUEUED unsigned(-1)
+
+// Indexed min-heap of (wake time, machine). A machine appears at most once and moving
+// its wake time re-keys the entry in place.
+class WakeQueue {
+public:
+    bool            Empty() const       { return heap.empty(); }
+    Time_t          TopTime() const     { return heap[0].time; }
+    MachineId_t     Pop();
+    void            Remove(MachineId_t machine_id);
+    void            Update(MachineId_t machine_id, Time_t time);
+private:
+    typedef struct {
+        Time_t      time;
+        MachineId_t machine_id;
+    } WakeEntry_t;
+
+    void            Place(unsigned index, WakeEntry_t entry);
+    void            SiftDown(unsigned index);
+    void            SiftUp(unsigned index);
+
+    vector<WakeEntry_t> heap;
+    vector<unsigned> position;
+};
+
+static WakeQueue wake_queue;
+
+// The machine each coasting task was last seen coasting on. A task that the scheduler
+// reads is settled on that machine first, see SetTaskCoasting(). Entries go when the
+// task completes; one whose machine went back to ticking settles to no effect.
+static unordered_map<TaskId_t, MachineId_t> coasting_tasks;
+
+void WakeQueue::Place(unsigned index, WakeEntry_t entry) {
+    heap[index] = entry;
+    position[entry.machine_id] = index;
+}
+
+void WakeQueue::SiftUp(unsigned index) {
+    WakeEntry_t entry = heap[index];
+    while(index > 0 && heap[(index - 1) / 2].time > entry.time) {
+        Place(index, heap[(index - 1) / 2]);
+        index = (index - 1) / 2;
+    }
+    Place(index, entry);
+}
+
+void WakeQueue::SiftDown(unsigned index) {
+    WakeEntry_t entry = heap[index];
+    unsigned size = unsigned(heap.size());
+    while(2 * index + 1 < size) {
+        unsigned child = 2 * index + 1;
+        if(child + 1 < size && heap[child + 1].time < heap[child].time) {
+            child++;
+        }
+        if(heap[child].time >= entry.time) {
+            break;
+        }
+        Place(index, heap[child]);
+        index = child;
+    }
+    Place(index, entry);
+}
+
+MachineId_t WakeQueue::Pop() {
+    MachineId_t machine_id = heap[0].machine_id;
+    Remove(machine_id);
+    return machine_id;
+}
+
+void WakeQueue::Remove(MachineId_t machine_id) {
+    if(machine_id >= position.size() || position[machine_id] == NOT_QUEUED) {
+        return;
+    }
+    unsigned index = position[machine_id];
+    position[machine_id] = NOT_QUEUED;
+    WakeEntry_t last = heap.back();
+    heap.pop_back();
+    if(index < heap.size()) {
+        Place(index, last);
+        SiftUp(index);
+        SiftDown(position[last.machine_id]);
+    }
+}
+
+void WakeQueue::Update(MachineId_t machine_id, Time_t time) {
+    if(machine_id >= position.size()) {
+        position.resize(machine_id + 1, NOT_QUEUED);
+    }
+    unsigned index = position[machine_id];
+    if(index == NOT_QUEUED) {
+        heap.push_back({time, machine_id});
+        index = unsigned(heap.size() - 1);
+        position[machine_id] = index;
+        SiftUp(index);
+    }
+    else if(time < heap[index].time) {
+        heap[index].time = time;
+        SiftUp(index);
+    }
+    else {
+        heap[index].time = time;
+        SiftDown(index);
+    }
+}
+
+static void SetTicking(MachineId_t machine_id) {
+    ticking[machine_id >> 6] |= uint64_t(1) << (machine_id & 63);
+}
+
+static void ClearTicking(MachineId_t machine_id) {
+    ticking[machine_id >> 6] &= ~(uint64_t(1) << (machine_id & 63));
+}
+
+static MachineId_t NextTicking(MachineId_t from) {
+    for(unsigned word = from >> 6; word < ticking.size(); word++) {
+        uint64_t bits = ticking[word];
+        if(word == from >> 6) {
+            bits &= ~uint64_t(0) << (from & 63);
+        }
+        if(bits != 0) {
+            return MachineId_t((word << 6) + __builtin_ctzll(bits));
+        }
+    }
+    return MachineId_t(Machines.size());
+}
+
+// Optional worker threads, enabled by setting CLOUDSIM_THREADS to the total number of
+// threads. A tick is cut into runs of consecutive machines whose ticks are quiet. The
+// machines of a run cannot affect each other or anything outside themselves, so they
+// tick concurrently and their logs are then replayed in machine order. Ticks that call
+// back into the scheduler run one at a time on the simulator thread, in between runs.
+// The result is the same as with a single thread, bit for bit.
+class TickWorkers {
+public:
+    ~TickWorkers();
+    unsigned        Size() const        { return unsigned(threads.size()) + 1; }
+    void            Run(vector<MachineId_t> & batch, vector<TickLog_t> & logs);
+    void            Start(unsigned workers);
+    void            Stop();
+private:
+    void            RunShare();
+    void            Work(uint64_t seen);
+
+    vector<thread>  threads;
+    mutex           lock;
+    condition_variable start;
+    condition_variable done;
+    uint64_t        generation = 0;
+    unsigned        busy = 0;
+    bool            stop = false;
+    atomic<unsigned> next{0};
+    vector<MachineId_t> * batch = nullptr;
+    vector<TickLog_t> * logs = nullptr;
+};
+
+static TickWorkers tick_workers;
+
+TickWorkers::~TickWorkers() {
+    Stop();
+}
+
+// Workers only ever start or stop between two runs, on the simulator thread
+void TickWorkers::Start(unsigned workers) {
+    for(unsigned i = 0; i < workers; i++) {
+        threads.emplace_back(&TickWorkers::Work, this, generation);
+    }
+}
+
+void TickWorkers::Stop() {
+    {
+        lock_guard<mutex> guard(lock);
+        stop = true;
+    }
+    start.notify_all();
+    for(thread & worker : threads) {
+        worker.join();
+    }
+    threads.clear();
+    stop = false;
+}
+
+void TickWorkers::RunShare() {
+    for(unsigned i = next++; i < batch->size(); i = next++) {
+        TickLog_t & log = (*logs)[i];
+        tick_log = &log;
+        try {
+            Machines[(*batch)[i]].HandleTimer();
+        }
+        catch(...) {
+            log.error = current_exception();
+        }
+        tick_log = nullptr;
+    }
+}
+
+void TickWorkers::Work(uint64_t seen) {
+    while(true) {
+        {
+            unique_lock<mutex> guard(lock);
+            start.wait(guard, [&] { return stop || generation != seen; });
+            if(stop) {
+                return;
+            }
+            seen = generation;
+        }
+        RunShare();
+        {
+            lock_guard<mutex> guard(lock);
+            if(--busy == 0) {
+                done.notify_one();
+            }
+        }
+    }
+}
+
+void TickWorkers::Run(vector<MachineId_t> & batch, vector<TickLog_t> & logs) {
+    {
+        lock_guard<mutex> guard(lock);
+        this->batch = &batch;
+        this->logs = &logs;
+        next = 0;
+        busy = unsigned(threads.size());
+        generation++;
+    }
+    start.notify_all();
+    RunShare();
+    unique_lock<mutex> guard(lock);
+    done.wait(guard, [&] { return busy == 0; });
+}
+
+static void ValidateMachineId(MachineId_t machine_id, const char * caller) {
+    if(machine_id >= Machines.size()) {
+        ThrowException(string(caller) + "(): Invalid machine id " + to_string(machine_id));
+    }
+}
+
+unsigned CPU::Power() {
+    return Machines[machine_id].GetCorePower(c_state, p_state);
+}
+
+void CPU::ChangeState(CPUState_t c_state, CPUPerformance_t p_state) {
+    unsigned before = Power();
+    this->c_state = c_state;
+    this->p_state = p_state;
+    Machines[machine_id].ChangePower(before, Power());
+}
+
+void CPU::SetCState(CPUState_t c_state) {
+    if(this->c_state == C0) {
+        ThrowException("Machine::CPU::SetState(): Fatal error, CPU cannot go idle while running a job!");
+    }
+    ChangeState(c_state, p_state);
+}
+
+void CPU::SetPState(CPUPerformance_t p_state) {
+    ChangeState(c_state, p_state);
+}
+
+// Time of the tick at which this core needs the machine's attention again. Until then
+// every tick would stop the task and put it straight back on this core.
+Time_t CPU::NextWake() {
+    if(projected_finish < quantum_end || remaining <= instr_to_run || quantum_instr == 0) {
+        return quantum_end;
+    }
+    uint64_t left = remaining - instr_to_run;
+    uint64_t quanta = (left + quantum_instr - 1) / quantum_instr;
+    return quantum_end + (quanta - 1) * TIMER_PERIOD;
+}
+
+// Whether the task runs out of instructions exactly at the end of the quantum that ends
+// at quantum_end, to be picked up as completed by the tick at that time.
+bool CPU::CompletesAt(Time_t quantum_end) {
+    if(!IsBusy()) {
+        return false;
+    }
+    if(quantum_end <= this->quantum_end) {
+        return remaining == instr_to_run;
+    }
+    uint64_t quanta = (quantum_end - this->quantum_end) / TIMER_PERIOD;
+    return remaining - instr_to_run - (quanta - 1) * quantum_instr == quantum_instr;
+}
+
+// Charges the quanta the task coasted through, leaving the core as if the task had
+// been dispatched for the quantum that ends at quantum_end.
+void CPU::Settle(Time_t quantum_end) {
+    if(!IsBusy() || quantum_end <= this->quantum_end) {
+        return;
+    }
+    uint64_t quanta = (quantum_end - this->quantum_end) / TIMER_PERIOD;
+    remaining -= instr_to_run + (quanta - 1) * quantum_instr;
+    SetTaskRemaining(job.task_id, remaining);
+    instr_to_run = quantum_instr;
+    this->quantum_end = quantum_end;
+    projected_finish = quantum_end;
+}
+
+void CPU::TaskRun(Job & job, unsigned slowdown, Time_t next_timer) {
+    Output("CPU:TaskRun(): Now " + to_string(Now()), 4);
+    Output("CPU:TaskRun(): Slowdown " + to_string(slowdown) + " " + " next timer " + to_string(next_timer), 4);
+    if(c_state == C0) {
+        ThrowException("Machine::CPU::TaskRun(): Fatal error, CPU was already in C0 state!");
+    }
+    ChangeState(C0, p_state);
+    this->job = job;
+    remaining = GetTaskRemaining(job.task_id);
+    Time_t timeq = next_timer - Now();
+    unsigned mips = Machines[machine_id].GetMIPS(p_state);
+    uint64_t rate = uint64_t(mips) * 100 / slowdown;
+    instr_to_run = rate * timeq;
+    quantum_instr = rate * TIMER_PERIOD;
+    Output("CPU:TaskRun(): Instr to run  " + to_string(instr_to_run), 4);
+    if(gpu && IsTaskGPUCapable(job.task_id)) {
+        instr_to_run *= GPU_SPEEDUP;
+        quantum_instr *= GPU_SPEEDUP;
+    }
+    quantum_end = next_timer;
+    Output("CPU:TaskRun(): Remaining " + to_string(remaining) + " " + " instr to run  " + to_string(instr_to_run), 4);
+    Output("CPU:TaskRun(): Performance parameter was " + to_string(mips), 4);
+    if(remaining < instr_to_run) {
+        // The task completes within this quantum
+        Time_t run_time = timeq * remaining / instr_to_run;
+        if(run_time == 0) {
+            run_time = 1;
+        }
+        projected_finish = Now() + run_time;
+        Output("CPU:TaskRun(): Timeq is " + to_string(timeq), 4);
+        instr_to_run = remaining;
+        Output("CPU:TaskRun(): Positive, Projected finish " + to_string(projected_finish) + " " + " instr to run  " + to_string(instr_to_run), 4);
+    }
+    else {
+        projected_finish = next_timer;
+        Output("CPU:TaskRun(): Negatove, Projected finish " + to_string(projected_finish) + " " + " instr to run  " + to_string(instr_to_run), 4);
+    }
+}
+
+void CPU::TaskStop() {
+    if(c_state != C0) {
+        ThrowException("Machine::CPU::TaskStop(): Fatal error, stopping a CPU that was not in C0 state!");
+    }
+    ChangeState(C1, p_state);
+    SetTaskRemaining(job.task_id, remaining - instr_to_run);
+}
+
+Machine::Machine(const MachineClassInfo_t & machine_class, MachineId_t id)
+    : slowdown(NORMAL_SLOWDOWN), changing_state(false), target_state(S0), state_countdown(0), dirty(false), delta_pending(false), energy(0), power(0), energy_time(Now()) {
+    for(unsigned i = 0; i < machine_class.num_cpus; i++) {
+        cpus.push_back(CPU(id, i, machine_class.gpus));
+    }
+    info.num_cpus = machine_class.num_cpus;
+    info.cpu = machine_class.cpu;
+    info.memory_size = machine_class.memory_size;
+    info.memory_used = 0;
+    info.active_tasks = 0;
+    info.active_vms = 0;
+    info.gpus = machine_class.gpus;
+    info.energy_consumed = 0;
+    info.machine_class = machine_class.machine_class;
+    info.s_state = S0;
+    info.p_state = P0;
+    info.machine_id = id;
+}
+
+void Machine::ChangePower(unsigned from, unsigned to) {
+    Time_t now = Now();
+    energy += power * (now - energy_time);
+    energy_time = now;
+    power = power - from + to;
+    if(tick_log != nullptr) {
+        // The cluster total was brought up to now before the workers started
+        tick_log->power_delta += uint64_t(to) - from;
+        return;
+    }
+    AdvanceClusterEnergy(now);
+    cluster_power = cluster_power - from + to;
+    Metrics_Power(cluster_power);
+}
+
+uint64_t Machine::GetEnergy() {
+    Time_t now = Now();
+    energy += power * (now - energy_time);
+    energy_time = now;
+    return energy;
+}
+
+const MachineInfo_t & Machine::GetInfo() {
+    info.energy_consumed = GetEnergy();
+    return info;
+}
+
+Time_t Machine::NextTimer() {
+    uint64_t ticks = timer_ticks;
+    if(timer_in_progress && info.machine_id > timer_cursor) {
+        ticks--;
+    }
+    return (ticks + 1) * TIMER_PERIOD;
+}
+
+void Machine::NoteChange() {
+    if(!delta_pending) {
+        delta_pending = true;
+        pending_deltas.push_back({info.machine_id, int(info.memory_used), int(info.active_tasks), int(info.active_vms), info.s_state, info.s_state});
+    }
+}
+
+// Turns the entry NoteChange() opened into the change since then. Returns false if the
+// machine ended up where it started.
+bool Machine::TakeDelta(MachineDelta_t & delta) {
+    delta_pending = false;
+    delta.memory_used = int(info.memory_used) - delta.memory_used;
+    delta.active_tasks = int(info.active_tasks) - delta.active_tasks;
+    delta.active_vms = int(info.active_vms) - delta.active_vms;
+    delta.s_state = info.s_state;
+    return delta.memory_used != 0 || delta.active_tasks != 0 || delta.active_vms != 0 || delta.s_state != delta.previous_state;
+}
+
+void Machine::MarkDirty() {
+    dirty = true;
+    SetTicking(info.machine_id);
+}
+
+// After a tick the busy cores hold the highest priority tasks in order and nothing is
+// queued. Unless something disturbs the machine, later ticks only repeat that layout.
+bool Machine::CanCoast() {
+    if(dirty || changing_state || info.s_state != S0) {
+        return false;
+    }
+    for(auto & queue : run_queue) {
+        if(!queue.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Machine::Coast() {
+    for(CPU & cpu : cpus) {
+        if(cpu.IsBusy()) {
+            coasting_tasks[cpu.GetJob().task_id] = info.machine_id;
+            SetTaskCoasting(cpu.GetJob().task_id, true);
+        }
+    }
+}
+
+Time_t Machine::NextWake() {
+    Time_t wake = Time_t(-1);
+    for(CPU & cpu : cpus) {
+        if(cpu.IsBusy()) {
+            wake = min(wake, cpu.NextWake());
+        }
+    }
+    return wake;
+}
+
+void Machine::Settle(Time_t quantum_end) {
+    for(CPU & cpu : cpus) {
+        cpu.Settle(quantum_end);
+    }
+}
+
+// A tick that neither completes a task nor finishes an S-state change stays inside the
+// machine: it calls back into neither the scheduler nor the VMs.
+bool Machine::IsQuietTick() {
+    if(changing_state && state_countdown == 1) {
+        return false;
+    }
+    if(info.s_state != S0) {
+        return true;
+    }
+    for(CPU & cpu : cpus) {
+        if(cpu.CompletesAt(Now())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Machine::IsIdle() {
+    if(changing_state) {
+        return false;
+    }
+    for(auto & queue : run_queue) {
+        if(!queue.empty()) {
+            return false;
+        }
+    }
+    for(CPU & cpu : cpus) {
+        if(cpu.IsBusy()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Machine::UpdateMemory(int size) {
+    unsigned previous = slowdown;
+    info.memory_used += size;
+    // MemoryWarning() is raised by the VM operation that overcommitted the machine once
+    // it is complete, the scheduler may migrate VMs off this machine in response
+    if(info.memory_used > info.memory_size) {
+        slowdown = info.memory_used > 2 * info.memory_size ? THRASHING_SLOWDOWN : SWAPPING_SLOWDOWN;
+    }
+    else {
+        slowdown = NORMAL_SLOWDOWN;
+    }
+    if(slowdown != previous) {
+        // The running tasks pick up the new rate at the next tick
+        MarkDirty();
+    }
+}
+
+void Machine::TaskAdd(TaskId_t task_id, VMId_t vm_id) {
+    NoteChange();
+    info.active_tasks++;
+    Job job = {task_id, vm_id};
+    UpdateMemory(GetTaskMemory(task_id));
+    Output("Machine::AttachTask(): Memory used is " + to_string(info.memory_used), 4);
+    MarkDirty();
+    Trace_TaskAttached(task_id, vm_id, info.machine_id);
+    for(CPU & cpu : cpus) {
+        if(!cpu.IsBusy()) {
+            TaskRun(task_id, vm_id, cpu.GetId());
+            return;
+        }
+    }
+    run_queue[GetTaskPriority(task_id)].push(job);
+}
+
+void Machine::TaskFinish(unsigned core_id) {
+    Job job = cpus[core_id].GetJob();
+    Output("Machine::TaskFinish(): About to remove task_id " + to_string(job.task_id), 4);
+    MarkDirty();
+    cpus[core_id].TaskStop();
+    TaskRemove(job.task_id, job.vm_id);
+    for(auto & queue : run_queue) {
+        if(!queue.empty()) {
+            Job next = queue.front();
+            queue.pop();
+            TaskRun(next.task_id, next.vm_id, core_id);
+            break;
+        }
+    }
+}
+
+void Machine::TaskRemove(TaskId_t task_id, VMId_t vm_id) {
+    NoteChange();
+    info.active_tasks--;
+    UpdateMemory(-int(GetTaskMemory(task_id)));
+    Output("Machine::TaskRemove(): About to remove task_id " + to_string(task_id), 4);
+    VM_RemoveTask(vm_id, task_id);
+    Output("Machine::TaskRemove(): Checking migration", 4);
+    if(VM_IsPendingMigration(vm_id)) {
+        Migrate(vm_id);
+    }
+    Output("Machine::TaskRemove(): Checked migration", 4);
+    if(coasting_tasks.erase(task_id) != 0) {
+        SetTaskCoasting(task_id, false);
+    }
+    CompleteTask(task_id);
+    HandleTaskCompletion(Now(), task_id);
+}
+
+void Machine::TaskRun(TaskId_t task_id, VMId_t vm_id, unsigned core_id) {
+    Job job = {task_id, vm_id};
+    Time_t next_timer = NextTimer();
+    cpus[core_id].TaskRun(job, slowdown, next_timer);
+    Output("Machine::TaskRun(): About to test next timer versus next", 4);
+    Time_t projected_finish = cpus[core_id].GetProjectedFinish();
+    Output("Machine::TaskRun(): About to test! Next timer " + to_string(next_timer) + " and projected finish " + to_string(projected_finish), 4);
+    if(projected_finish < next_timer) {
+        if(tick_log != nullptr) {
+            tick_log->records.push_back({TICK_COMPLETION, string(), core_id, projected_finish});
+        }
+        else {
+            ScheduleTaskCompletion(projected_finish, info.machine_id, core_id);
+        }
+    }
+}
+
+void Machine::AttachVM(VMId_t vm_id) {
+    if(info.s_state != S0) {
+        ThrowException("Machine::AttachVM(): Attempt at attaching virtual machine " + to_string(vm_id) + " to machine " + to_string(info.machine_id) + " while in sleep mode");
+    }
+    NoteChange();
+    UpdateMemory(VM_MEMORY_OVERHEAD);
+    info.active_vms++;
+}
+
+void Machine::DetachVM(VMId_t vm_id) {
+    if(info.s_state != S0) {
+        ThrowException("Machine::DetachVM(): Attempt at dettaching virtual machine " + to_string(vm_id) + " from machine " + to_string(info.machine_id) + " while in sleep mode");
+    }
+    for(CPU & cpu : cpus) {
+        if(cpu.IsBusy() && cpu.GetJob().vm_id == vm_id) {
+            ThrowException("Machine::DettachVM(): Attempt at dettaching virtual machine " + to_string(vm_id) + " from machine " + to_string(info.machine_id) + " while tasks running");
+        }
+    }
+    for(auto & queue : run_queue) {
+        size_t size = queue.size();
+        for(unsigned i = 0; i < size; i++) {
+            Job job = queue.front();
+            queue.pop();
+            if(job.vm_id == vm_id) {
+                ThrowException("Machine::DettachVM(): Attempt at dettaching virtual machine " + to_string(vm_id) + " from machine " + to_string(info.machine_id) + " while tasks queued");
+            }
+            queue.push(job);
+        }
+    }
+    NoteChange();
+    UpdateMemory(-VM_MEMORY_OVERHEAD);
+    info.active_vms--;
+}
+
+void Machine::HandleTimer() {
+    queue<Job> completed;
+    Output("Machine::HandleTimer(): About to remove tasks from processor", 4);
+    dirty = false;
+    Settle(NextTimer() - TIMER_PERIOD);
+    if(info.s_state == S0) {
+        for(CPU & cpu : cpus) {
+            if(cpu.IsBusy()) {
+                Output("Machine::HandleTimer(): About to remove a task", 4);
+                Job job = cpu.GetJob();
+                cpu.TaskStop();
+                if(IsTaskCompleted(job.task_id)) {
+                    completed.push(job);
+                }
+                else {
+                    run_queue[GetTaskPriority(job.task_id)].push(job);
+                }
+            }
+        }
+    }
+    Output("Machine::HandleTimer(): Done removing tasks", 4);
+    bool state_changed = false;
+    if(changing_state) {
+        state_countdown--;
+        if(state_countdown == 0) {
+            changing_state = false;
+            state_changed = true;
+            SetNewState(target_state);
+        }
+    }
+    Output("Machine::HandleTimer(): About to run tasks", 4);
+    if(info.s_state == S0) {
+        unsigned core_id = 0;
+        for(auto & queue : run_queue) {
+            while(!queue.empty() && core_id < cpus.size()) {
+                Job job = queue.front();
+                queue.pop();
+                Output("Machine::HandleTimer(): Running a task", 4);
+                Output("Trying with core " + to_string(core_id), 4);
+                if(cpus[core_id].IsBusy()) {
+                    Output("Core is busy!", 4);
+                }
+                else {
+                    Output("Core is no longer busy", 4);
+                }
+                TaskRun(job.task_id, job.vm_id, core_id);
+                core_id++;
+            }
+        }
+    }
+    while(!completed.empty()) {
+        Job job = completed.front();
+        completed.pop();
+        TaskRemove(job.task_id, job.vm_id);
+    }
+    if(state_changed) {
+        StateChangeComplete(Now(), info.machine_id);
+    }
+}
+
+void Machine::Migrate(VMId_t vm_id) {
+    bool possible = true;
+    NoteChange();
+    Settle(NextTimer());
+    MarkDirty();
+    for(CPU & cpu : cpus) {
+        if(cpu.GetJob().vm_id == vm_id && cpu.IsBusy()) {
+            if(cpu.GetProjectedFinish() < NextTimer()) {
+                possible = false;
+                Output("Machine::Migrate(): Task is finishing. Postponing migration", 4);
+            }
+            else {
+                UpdateMemory(-int(GetTaskMemory(cpu.GetJob().task_id)));
+                cpu.TaskStop();
+                info.active_tasks--;
+                Output("Machine::Migrate(): Removed task from CPU due to migration.", 4);
+            }
+        }
+    }
+    for(auto & queue : run_queue) {
+        size_t size = queue.size();
+        for(unsigned i = 0; i < size; i++) {
+            Job job = queue.front();
+            queue.pop();
+            if(job.vm_id != vm_id) {
+                queue.push(job);
+            }
+            else {
+                UpdateMemory(-int(GetTaskMemory(job.task_id)));
+                info.active_tasks--;
+                Output("Machine::Migrate(): Removed task from the run queue due to migration.", 4);
+            }
+        }
+    }
+    if(possible) {
+        Output("Machine::Migrate(): Migration is possible", 4);
+        UpdateMemory(-VM_MEMORY_OVERHEAD);
+        Trace_MigrationStarted(vm_id, info.machine_id);
+        VM_MigrationStarted(vm_id);
+        info.active_vms--;
+        ScheduleMigrationCompletion(Now() + MIGRATION_LATENCY, vm_id);
+    }
+}
+
+void Machine::SetNewState(MachineState_t s_state) {
+    static const CPUState_t s_to_c[S_STATES] = {C1, C1, C2, C4, C4, C4, C4};
+    NoteChange();
+    const vector<unsigned> & s_states = GetClassInfo().s_states;
+    ChangePower(s_states[info.s_state], s_states[s_state]);
+    Metrics_SState(info.s_state, s_state);
+    info.s_state = s_state;
+    for(CPU & cpu : cpus) {
+        cpu.SetCState(s_to_c[s_state]);
+    }
+    Trace_SState(info.machine_id, s_state);
+}
+
+void Machine::SetPerformance(CPUPerformance_t p_state) {
+    if(p_state != info.p_state) {
+        Trace_PState(info.machine_id, p_state);
+    }
+    for(CPU & cpu : cpus) {
+        cpu.SetPState(p_state);
+    }
+    info.p_state = p_state;
+    MarkDirty();
+}
+
+void Machine::SetState(MachineState_t s_state) {
+    // Number of timer ticks it takes to go from one S-state (row) to another (column)
+    static const unsigned transitions[S_STATES][S_STATES] = {
+        {   0,    1,    1,   10,   25,   50,  250},
+        {   1,    0,    5,   20,   20,   50,  150},
+        {   5,    1,    0,   10,   20,   50,  150},
+        {  50,   75,   20,    0,   20,   50,  150},
+        { 100,   80,   50,   20,    0,   50,  150},
+        { 200,  150,  100,  100,   50,    0,  150},
+        {5000, 4000, 3000, 3000, 3000, 3000,    0}
+    };
+    if(s_state == info.s_state) {
+        StateChangeComplete(Now(), info.machine_id);
+        return;
+    }
+    changing_state = true;
+    state_countdown = transitions[info.s_state][s_state];
+    target_state = s_state;
+    MarkDirty();
+}
+
+// Public interface below
+
+CPUType_t Machine_GetCPUType(MachineId_t machine_id) {
+    ValidateMachineId(machine_id, "Machine_GetCPUType");
+    return Machines[machine_id].GetMachineCPUType();
+}
+
+double Machine_GetClusterEnergy() {
+    AdvanceClusterEnergy(Now());
+    return double(cluster_energy) / 3600000000000.0;
+}
+
+uint64_t Machine_GetEnergy(MachineId_t machine_id) {
+    ValidateMachineId(machine_id, "Machine_GetEnergy");
+    return Machines[machine_id].GetEnergy();
+}
+
+MachineInfo_t Machine_GetInfo(MachineId_t machine_id) {
+    ValidateMachineId(machine_id, "Machine_GetInfo");
+    return Machines[machine_id].GetInfo();
+}
+
+const MachineInfo_t & Machine_GetInfoRef(MachineId_t machine_id) {
+    ValidateMachineId(machine_id, "Machine_GetInfoRef");
+    return Machines[machine_id].GetInfo();
+}
+
+const MachineClassInfo_t & Machine_GetClassInfo(MachineId_t machine_id) {
+    ValidateMachineId(machine_id, "Machine_GetClassInfo");
+    return Machines[machine_id].GetClassInfo();
+}
+
+unsigned Machine_GetActiveTasks(MachineId_t machine_id) {
+    ValidateMachineId(machine_id, "Machine_GetActiveTasks");
+    return Machines[machine_id].GetActiveTasks();
+}
+
+unsigned Machine_GetActiveVMs(MachineId_t machine_id) {
+    ValidateMachineId(machine_id, "Machine_GetActiveVMs");
+    return Machines[machine_id].GetActiveVMs();
+}
+
+unsigned Machine_GetFreeMemory(MachineId_t machine_id) {
+    ValidateMachineId(machine_id, "Machine_GetFreeMemory");
+    return Machines[machine_id].GetFreeMemory();
+}
+
+unsigned Machine_GetTotal() {
+    return unsigned(Machines.size());
+}
+
+void Machine_SetCorePerformance(MachineId_t machine_id, unsigned core_id, CPUPerformance_t p_state) {
+    // All the cores of a machine run at the same P-state, core_id is there for future use
+    ValidateMachineId(machine_id, "Machine_SetCorePerformance");
+    Machines[machine_id].SetPerformance(p_state);
+}
+
+void Machine_SetState(MachineId_t machine_id, MachineState_t s_state) {
+    ValidateMachineId(machine_id, "Machine_SetState");
+    Machines[machine_id].SetState(s_state);
+}
+
+void Machine_Add(u_int mem, u_int cores, vector<u_int> & s_states, vector<u_int> & c_states, vector<u_int> & p_states, vector<u_int> & mips, bool gpu, CPUType_t cpu) {
+    static bool timer_initiated = false;
+    if(!timer_initiated) {
+        ScheduleTimer(TIMER_PERIOD);
+        timer_initiated = true;
+    }
+    unsigned machine_class = unsigned(Machine_classes.size());
+    for(unsigned i = machine_class; i > 0; i--) {
+        const MachineClassInfo_t & known = Machine_classes[i - 1];
+        if(known.num_cpus == cores && known.cpu == cpu && known.memory_size == mem && known.gpus == gpu &&
+           known.performance == mips && known.c_states == c_states && known.p_states == p_states && known.s_states == s_states) {
+            machine_class = i - 1;
+            break;
+        }
+    }
+    if(machine_class == Machine_classes.size()) {
+        Machine_classes.push_back({cores, cpu, mem, gpu, mips, c_states, p_states, s_states, machine_class});
+    }
+    MachineId_t id = MachineId_t(Machines.size());
+    Machines.push_back(Machine(Machine_classes[machine_class], id));
+    ticking.resize((Machines.size() + 63) / 64, 0);
+    // A new machine starts in S0 with all of its cores halted in C1
+    Machine & machine = Machines.back();
+    machine.ChangePower(0, s_states[S0]);
+    for(unsigned i = 0; i < cores; i++) {
+        machine.ChangePower(0, machine.GetCorePower(C1, P0));
+    }
+}
+
+void Machine_AttachTask(MachineId_t machine_id, TaskId_t task_id, VMId_t vm_id) {
+    ValidateMachineId(machine_id, "Machine_AttachTask");
+    Output("AttachTask(): Attaching Task " + to_string(task_id) + " to machine " + to_string(machine_id) + " at time " + to_string(Now()), 4);
+    Machines[machine_id].TaskAdd(task_id, vm_id);
+}
+
+void Machine_AttachVM(MachineId_t machine_id, VMId_t vm_id) {
+    ValidateMachineId(machine_id, "Machine_AttachVM");
+    Output("AttachVM(): Attaching VM " + to_string(vm_id) + " to machine " + to_string(machine_id), 4);
+    Machines[machine_id].AttachVM(vm_id);
+}
+
+void Machine_CompleteTask(MachineId_t machine_id, unsigned core_id) {
+    ValidateMachineId(machine_id, "Machine_CompleteTask");
+    Machines[machine_id].TaskFinish(core_id);
+}
+
+bool Machine_CheckMemoryOverflow(MachineId_t machine_id) {
+    ValidateMachineId(machine_id, "Machine_CheckMemoryOverflow");
+    return Machines[machine_id].MemoryOverflow();
+}
+
+void Machine_DetachVM(MachineId_t machine_id, VMId_t vm_id) {
+    ValidateMachineId(machine_id, "Machine_DetachVM");
+    Output("DetachVM(): " + to_string(vm_id) + " underway", 4);
+    Machines[machine_id].DetachVM(vm_id);
+}
+
+static void FinishTick(MachineId_t machine_id, Time_t time) {
+    Machine & machine = Machines[machine_id];
+    if(machine.IsIdle()) {
+        ClearTicking(machine_id);
+        wake_queue.Remove(machine_id);
+    }
+    else if(machine.CanCoast()) {
+        Time_t wake = machine.NextWake();
+        if(wake > time + TIMER_PERIOD) {
+            ClearTicking(machine_id);
+            wake_queue.Update(machine_id, wake);
+            machine.Coast();
+        }
+    }
+}
+
+// Runs the quiet ticks of a batch of machines on the workers, then plays their effects
+// back in machine order as if the machines had ticked one after the other.
+static void ParallelTick(vector<MachineId_t> & batch, Time_t time) {
+    static vector<TickLog_t> logs;
+    if(logs.size() < batch.size()) {
+        logs.resize(batch.size());
+    }
+    for(unsigned i = 0; i < batch.size(); i++) {
+        logs[i].records.clear();
+        logs[i].power_delta = 0;
+        logs[i].error = nullptr;
+    }
+    AdvanceClusterEnergy(time);
+    timer_cursor = batch.back();
+    tick_workers.Run(batch, logs);
+    for(unsigned i = 0; i < batch.size(); i++) {
+        TickLog_t & log = logs[i];
+        for(TickRecord_t & record : log.records) {
+            switch(record.type) {
+                case TICK_OUTPUT:
+                    SimOutput(record.msg, record.id);
+                    break;
+                case TICK_COMPLETION:
+                    ScheduleTaskCompletion(record.value, batch[i], record.id);
+                    break;
+                case TICK_REMAINING:
+                    SetRemainingInstructions(record.id, record.value);
+                    break;
+            }
+        }
+        if(log.error != nullptr) {
+            rethrow_exception(log.error);
+        }
+        cluster_power += log.power_delta;
+        Metrics_Power(cluster_power);
+        FinishTick(batch[i], time);
+    }
+}
+
+void Machine_HandleTimer(Time_t time) {
+    Output("HandleTimer() called at time " + to_string(time), 4);
+    // Only the machines with work pending see the tick. The scan picks up machines that a
+    // scheduler callback wakes up further down the list, just like a sweep over all of them.
+    timer_ticks++;
+    timer_in_progress = true;
+    while(!wake_queue.Empty() && wake_queue.TopTime() <= time) {
+        SetTicking(wake_queue.Pop());
+    }
+    static vector<MachineId_t> batch;
+    for(MachineId_t id = NextTicking(0); id < Machines.size(); ) {
+        if(tick_workers.Size() > 1) {
+            batch.clear();
+            for(MachineId_t next = id; next < Machines.size() && Machines[next].IsQuietTick(); next = NextTicking(next + 1)) {
+                batch.push_back(next);
+            }
+            if(batch.size() >= PARALLEL_TICK_MIN) {
+                ParallelTick(batch, time);
+                id = NextTicking(batch.back() + 1);
+                continue;
+            }
+            if(!batch.empty()) {
+                for(MachineId_t machine_id : batch) {
+                    timer_cursor = machine_id;
+                    Machines[machine_id].HandleTimer();
+                    FinishTick(machine_id, time);
+                }
+                id = NextTicking(batch.back() + 1);
+                continue;
+            }
+        }
+        timer_cursor = id;
+        Machines[id].HandleTimer();
+        FinishTick(id, time);
+        id = NextTicking(id + 1);
+    }
+    timer_in_progress = false;
+    if(GetActiveTasks() != 0) {
+        ScheduleTimer(Now() + TIMER_PERIOD);
+    }
+    Telemetry_Sample(Now());
+    SchedulerCheck(Now());
+}
+
+void Machine_ReportDeltas(Time_t time) {
+    if(pending_deltas.empty()) {
+        return;
+    }
+    // Whatever the scheduler changes while it looks at this batch goes into the next one
+    static vector<MachineDelta_t> deltas;
+    deltas.swap(pending_deltas);
+    pending_deltas.clear();
+    unsigned changed = 0;
+    for(MachineDelta_t & delta : deltas) {
+        if(Machines[delta.machine_id].TakeDelta(delta)) {
+            deltas[changed++] = delta;
+        }
+    }
+    deltas.resize(changed);
+    if(!deltas.empty()) {
+        MachineDeltas(time, deltas);
+    }
+}
+
+unsigned Machine_StopWorkers() {
+    unsigned workers = tick_workers.Size() - 1;
+    tick_workers.Stop();
+    return workers;
+}
+
+void Machine_SettleTask(TaskId_t task_id) {
+    auto entry = coasting_tasks.find(task_id);
+    if(entry == coasting_tasks.end()) {
+        SetTaskCoasting(task_id, false);
+        return;
+    }
+    Machines[entry->second].SettleCurrent();
+}
+
+void Machine_StartWorkers(unsigned workers) {
+    tick_workers.Start(workers);
+}
+
+void Machine_MigrateVM(VMId_t vm_id, MachineId_t current, MachineId_t next) {
+    ValidateMachineId(current, "MigrateVM");
+    ValidateMachineId(next, "MigrateVM");
+    if(!Machines[current].IsReady()) {
+        ThrowException("MigrateVM(): Trying to migrate VM " + to_string(vm_id) + " from machine " + to_string(current) + " while the machine is in sleep mode");
+    }
+    if(!Machines[next].IsReady()) {
+        ThrowException("MigrateVM(): Trying to migrate VM " + to_string(vm_id) + " to machine " + to_string(next) + " while the machine is in sleep mode");
+    }
+    Machines[current].Migrate(vm_id);
+}
@@ -0,0 +1,248 @@
+//
+//  Metrics.cpp
+//  CloudSim
+//
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Interfaces.h"
+#include "Internal_Interfaces.h"
+
+#define WINDOW_SLOTS        8           // Steps a window slides by, per window
+#define WORST_WINDOWS       3           // Windows GetWorstWindows() keeps
+
+// SLA, energy and awake machines over a window that slides along the run, CLOUDSIM_WINDOW
+// us long (2 s by default). The window is cut into WINDOW_SLOTS slots. Completions, the
+// energy drawn and the time machines spend in S0 go into the slot being filled, and when
+// a slot ends it replaces the oldest one in the window's running sums. Every completion,
+// change in the cluster's power draw or S-state change is therefore O(1), plus a step
+// for every slot boundary crossed since the previous one.
+//
+// Energy and awake time are integrated between changes, so a slot gets exactly its share
+// of a change that straddles it. GetWindowReport() answers the window that ends at the
+// last slot boundary, and GetWorstWindows() the few windows of the run with the most
+// SLA0-2 violations, of which no two overlap.
+class WindowedMetrics {
+public:
+    void            Start();
+    void            Power(Time_t now, uint64_t power);
+    void            SState(Time_t now, MachineState_t from, MachineState_t to);
+    void            TaskCompleted(Time_t now, SLAType_t sla, bool violated);
+    WindowReport_t  Last(Time_t now);
+    vector<WindowReport_t> Worst(Time_t now);
+private:
+    typedef struct {
+        unsigned    completed[NUM_SLAS];
+        unsigned    violations[NUM_SLAS];
+        uint64_t    energy;                     // In the units of the power tables times us
+        uint64_t    awake_time;                 // Machines in S0 times us
+    } Slot_t;
+    typedef struct {
+        Slot_t      sums;
+        Time_t      start;
+        Time_t      end;
+        unsigned    violations;                 // SLA0-2
+    } Window_t;
+
+    static void     Add(Slot_t & to, const Slot_t & slot);
+    static void     Subtract(Slot_t & from, const Slot_t & slot);
+    static WindowReport_t Report(const Slot_t & sums, Time_t start, Time_t end);
+    void            Advance(Time_t now);
+    void            CloseSlot();
+    void            Integrate(Time_t until);
+    void            KeepIfWorst();
+
+    bool            started = false;
+    Time_t          slot_length = 0;
+    Time_t          slot_end = 0;               // Of the slot being filled
+    Time_t          last = 0;                   // Energy and awake time are integrated up to here
+    uint64_t        power = 0;                  // Of the cluster
+    unsigned        awake = 0;
+
+    Slot_t          filling = {};
+    Slot_t          slots[WINDOW_SLOTS] = {};   // The last slots that ended, a ring
+    unsigned        oldest = 0;
+    uint64_t        closed = 0;                 // Slots that ended
+    Slot_t          window = {};                // Sum of the ring
+
+    vector<Window_t> worst;
+};
+
+static WindowedMetrics metrics;
+
+void WindowedMetrics::Add(Slot_t & to, const Slot_t & slot) {
+    for(unsigned sla = 0; sla < NUM_SLAS; sla++) {
+        to.completed[sla] += slot.completed[sla];
+        to.violations[sla] += slot.violations[sla];
+    }
+    to.energy += slot.energy;
+    to.awake_time += slot.awake_time;
+}
+
+void WindowedMetrics::Subtract(Slot_t & from, const Slot_t & slot) {
+    for(unsigned sla = 0; sla < NUM_SLAS; sla++) {
+        from.completed[sla] -= slot.completed[sla];
+        from.violations[sla] -= slot.violations[sla];
+    }
+    from.energy -= slot.energy;
+    from.awake_time -= slot.awake_time;
+}
+
+WindowReport_t WindowedMetrics::Report(const Slot_t & sums, Time_t start, Time_t end) {
+    WindowReport_t report;
+    report.start = start;
+    report.end = end;
+    for(unsigned sla = 0; sla < NUM_SLAS; sla++) {
+        report.completed[sla] = sums.completed[sla];
+        report.violations[sla] = sums.violations[sla];
+    }
+    report.energy = double(sums.energy) / 3600000000000.0;
+    report.awake_hosts = end > start ? double(sums.awake_time) / double(end - start) : 0.0;
+    return report;
+}
+
+void WindowedMetrics::Start() {
+    if(started) {
+        return;
+    }
+    Time_t window = 2000000;
+    const char * setting = getenv("CLOUDSIM_WINDOW");
+    if(setting != NULL) {
+        char * end;
+        window = strtoull(setting, &end, 10);
+        if(*setting == '\0' || *end != '\0' || window < WINDOW_SLOTS) {
+            ThrowException("Metrics(): Invalid window ", setting);
+        }
+    }
+    slot_length = window / WINDOW_SLOTS;
+    awake = 0;
+    for(MachineId_t machine_id = 0; machine_id < Machine_GetTotal(); machine_id++) {
+        awake += Machine_GetInfoRef(machine_id).s_state == S0;
+    }
+    last = Now();
+    slot_end = last + slot_length;
+    worst.reserve(WORST_WINDOWS);
+    started = true;
+}
+
+void WindowedMetrics::Integrate(Time_t until) {
+    filling.energy += power * (until - last);
+    filling.awake_time += uint64_t(awake) * (until - last);
+    last = until;
+}
+
+// A window is kept when it has more violations than the window it overlaps, or, when it
+// overlaps none, than the mildest one kept. Windows end one slot apart, so only the last
+// one kept can overlap the new one.
+void WindowedMetrics::KeepIfWorst() {
+    Window_t candidate;
+    candidate.sums = window;
+    candidate.end = slot_end;
+    candidate.start = slot_end - Time_t(min<uint64_t>(closed, WINDOW_SLOTS)) * slot_length;
+    candidate.violations = window.violations[SLA0] + window.violations[SLA1] + window.violations[SLA2];
+    if(candidate.violations == 0) {
+        return;
+    }
+    if(!worst.empty() && worst.back().end > candidate.start) {
+        if(candidate.violations > worst.back().violations) {
+            worst.back() = candidate;
+        }
+        return;
+    }
+    if(worst.size() < WORST_WINDOWS) {
+        worst.push_back(candidate);
+        return;
+    }
+    auto mildest = min_element(worst.begin(), worst.end(), [](const Window_t & a, const Window_t & b) { return a.violations < b.violations; });
+    if(candidate.violations > mildest->violations) {
+        worst.erase(mildest);
+        worst.push_back(candidate);
+    }
+}
+
+void WindowedMetrics::CloseSlot() {
+    Subtract(window, slots[oldest]);
+    slots[oldest] = filling;
+    Add(window, filling);
+    oldest = (oldest + 1) % WINDOW_SLOTS;
+    filling = {};
+    closed++;
+    KeepIfWorst();
+}
+
+void WindowedMetrics::Advance(Time_t now) {
+    if(!started) {
+        return;
+    }
+    while(now >= slot_end) {
+        Integrate(slot_end);
+        CloseSlot();
+        slot_end += slot_length;
+    }
+    Integrate(now);
+}
+
+void WindowedMetrics::Power(Time_t now, uint64_t power) {
+    Advance(now);
+    this->power = power;
+}
+
+void WindowedMetrics::SState(Time_t now, MachineState_t from, MachineState_t to) {
+    if(!started || (from == S0) == (to == S0)) {
+        return;
+    }
+    Advance(now);
+    awake = to == S0 ? awake + 1 : awake - 1;
+}
+
+void WindowedMetrics::TaskCompleted(Time_t now, SLAType_t sla, bool violated) {
+    Advance(now);
+    filling.completed[sla]++;
+    filling.violations[sla] += violated;
+}
+
+WindowReport_t WindowedMetrics::Last(Time_t now) {
+    Advance(now);
+    Time_t end = slot_end - slot_length;
+    return Report(window, end - Time_t(min<uint64_t>(closed, WINDOW_SLOTS)) * slot_length, end);
+}
+
+vector<WindowReport_t> WindowedMetrics::Worst(Time_t now) {
+    Advance(now);
+    vector<Window_t> sorted = worst;
+    stable_sort(sorted.begin(), sorted.end(), [](const Window_t & a, const Window_t & b) { return a.violations > b.violations; });
+    vector<WindowReport_t> reports;
+    for(const Window_t & candidate : sorted) {
+        reports.push_back(Report(candidate.sums, candidate.start, candidate.end));
+    }
+    return reports;
+}
+
+void Metrics_Start() {
+    metrics.Start();
+}
+
+void Metrics_Power(uint64_t power) {
+    metrics.Power(Now(), power);
+}
+
+void Metrics_SState(MachineState_t from, MachineState_t to) {
+    metrics.SState(Now(), from, to);
+}
+
+void Metrics_TaskCompleted(SLAType_t sla, bool violated) {
+    metrics.TaskCompleted(Now(), sla, violated);
+}
+
+// Public interface below
+
+WindowReport_t GetWindowReport() {
+    return metrics.Last(Now());
+}
+
+vector<WindowReport_t> GetWorstWindows() {
+    return metrics.Worst(Now());
+}
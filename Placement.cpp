@@ -0,0 +1,232 @@
+//
+//  Placement.cpp
+//  CloudSim
+//
+
+#include <stdint.h>
+
+#include "Placement.hpp"
+
+void CapacityTree::Resize(unsigned size) {
+    leaves = 1;
+    while(leaves < size) {
+        leaves *= 2;
+    }
+    nodes.assign(2 * leaves, {ABSENT, INT64_MAX, 0, 0});
+    for(unsigned i = 0; i < leaves; i++) {
+        nodes[leaves + i].arg_max = i;
+        nodes[leaves + i].arg_min = i;
+    }
+    for(unsigned node = leaves - 1; node > 0; node--) {
+        Pull(node);
+    }
+}
+
+// Ties go to the left child, so equal hosts are chosen in index order
+void CapacityTree::Pull(unsigned node) {
+    const Node_t & left = nodes[2 * node];
+    const Node_t & right = nodes[2 * node + 1];
+    Node_t & parent = nodes[node];
+    if(right.max > left.max) {
+        parent.max = right.max;
+        parent.arg_max = right.arg_max;
+    }
+    else {
+        parent.max = left.max;
+        parent.arg_max = left.arg_max;
+    }
+    if(right.min < left.min) {
+        parent.min = right.min;
+        parent.arg_min = right.arg_min;
+    }
+    else {
+        parent.min = left.min;
+        parent.arg_min = left.arg_min;
+    }
+}
+
+void CapacityTree::Set(unsigned index, int64_t free_memory) {
+    unsigned node = leaves + index;
+    nodes[node].max = free_memory;
+    nodes[node].min = free_memory == ABSENT ? INT64_MAX : free_memory;
+    for(node /= 2; node > 0; node /= 2) {
+        Pull(node);
+    }
+}
+
+int CapacityTree::First(int64_t need) const {
+    if(leaves == 0 || nodes[1].max < need) {
+        return -1;
+    }
+    unsigned node = 1;
+    while(node < leaves) {
+        node = nodes[2 * node].max >= need ? 2 * node : 2 * node + 1;
+    }
+    return int(node - leaves);
+}
+
+int CapacityTree::Largest(int64_t need) const {
+    if(leaves == 0 || nodes[1].max < need) {
+        return -1;
+    }
+    return int(nodes[1].arg_max);
+}
+
+int CapacityTree::Smallest(int64_t need) const {
+    return leaves == 0 ? -1 : Smallest(1, need);
+}
+
+// Subtrees where nothing fits are skipped, and a subtree where everything fits answers
+// with its minimum, so only the nodes straddling need are opened up.
+int CapacityTree::Smallest(unsigned node, int64_t need) const {
+    if(nodes[node].max < need) {
+        return -1;
+    }
+    if(nodes[node].min >= need) {
+        return int(nodes[node].arg_min);
+    }
+    int left = Smallest(2 * node, need);
+    int right = Smallest(2 * node + 1, need);
+    if(left < 0) {
+        return right;
+    }
+    if(right < 0) {
+        return left;
+    }
+    return nodes[leaves + right].max < nodes[leaves + left].max ? right : left;
+}
+
+void PlacementEngine::Init(bool (*eligible)(MachineId_t machine_id), unsigned reserve_percent, const vector<MachineId_t> & order) {
+    this->eligible = eligible;
+    unsigned total = Machine_GetTotal();
+    groups.assign(CPU_TYPES * 2, Group_t());
+    position.assign(total, 0);
+    pools.assign(total, BATCH_POOL);
+    for(unsigned i = 0; i < total; i++) {
+        MachineId_t machine_id = order.empty() ? MachineId_t(i) : order[i];
+        const MachineInfo_t & info = Machine_GetInfoRef(machine_id);
+        Group_t & group = GroupOf(info.cpu, info.gpus);
+        position[machine_id] = unsigned(group.hosts.size());
+        group.hosts.push_back(machine_id);
+    }
+    for(Group_t & group : groups) {
+        // The first hosts of the group make up its latency pool
+        unsigned reserved = unsigned((uint64_t(group.hosts.size()) * reserve_percent + 99) / 100);
+        for(unsigned i = 0; i < reserved && i < group.hosts.size(); i++) {
+            pools[group.hosts[i]] = LATENCY_POOL;
+        }
+        for(auto & trees : group.trees) {
+            trees[0].Resize(unsigned(group.hosts.size()));
+            trees[1].Resize(unsigned(group.hosts.size()));
+        }
+    }
+    for(MachineId_t machine_id = 0; machine_id < total; machine_id++) {
+        Update(machine_id);
+    }
+}
+
+void PlacementEngine::Update(MachineId_t machine_id) {
+    const MachineInfo_t & info = Machine_GetInfoRef(machine_id);
+    CapacityTree * trees = GroupOf(info.cpu, info.gpus).trees[pools[machine_id]];
+    unsigned index = position[machine_id];
+    int64_t free_memory = int64_t(info.memory_size) - int64_t(info.memory_used);
+    if(!eligible(machine_id) || free_memory <= VM_MEMORY_OVERHEAD) {
+        trees[0].Remove(index);
+        trees[1].Remove(index);
+        return;
+    }
+    unsigned tier = info.active_tasks < info.num_cpus ? 0 : 1;
+    trees[tier].Set(index, free_memory);
+    trees[1 - tier].Remove(index);
+}
+
+int PlacementEngine::Search(Group_t & group, Pool_t pool, unsigned tier, int64_t need, FitPolicy_t policy) {
+    while(true) {
+        CapacityTree & tree = group.trees[pool][tier];
+        int index;
+        switch(policy) {
+            case FIRST_FIT:
+                index = tree.First(need);
+                break;
+            case BEST_FIT:
+                index = tree.Smallest(need);
+                break;
+            default:
+                index = tree.Largest(need);
+                break;
+        }
+        if(index < 0) {
+            return -1;
+        }
+        // The entry may predate changes made since the last update
+        MachineId_t machine_id = group.hosts[index];
+        const MachineInfo_t & info = Machine_GetInfoRef(machine_id);
+        bool idle_core = info.active_tasks < info.num_cpus;
+        if(eligible(machine_id) && int64_t(info.memory_size) - int64_t(info.memory_used) >= need && idle_core == (tier == 0)) {
+            return index;
+        }
+        Update(machine_id);
+    }
+}
+
+MachineId_t PlacementEngine::Find(TaskId_t task_id, FitPolicy_t policy, Pool_t pool) {
+    const TaskInfo_t & task = GetTaskInfoRef(task_id);
+    int64_t need = int64_t(task.required_memory) + VM_MEMORY_OVERHEAD;
+    Pool_t other = pool == LATENCY_POOL ? BATCH_POOL : LATENCY_POOL;
+    static const unsigned latency_order[4][2] = {{0, 0}, {1, 0}, {0, 1}, {1, 1}};     // {pool, tier}, tier first
+    static const unsigned batch_order[4][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};       // pool first
+    const unsigned (*order)[2] = pool == LATENCY_POOL ? latency_order : batch_order;
+    // A GPU capable task only goes to GPU hosts, anything else spills onto them
+    Group_t & own = GroupOf(task.required_cpu, task.gpu_capable);
+    Group_t * spill = task.gpu_capable ? nullptr : &GroupOf(task.required_cpu, true);
+    for(unsigned step = 0; step < 4; step++) {
+        Pool_t step_pool = order[step][0] == 0 ? pool : other;
+        unsigned tier = order[step][1];
+        if(spill != nullptr && tier == 1) {
+            int index = Search(*spill, step_pool, 0, need, policy);
+            if(index >= 0) {
+                return spill->hosts[index];
+            }
+        }
+        int index = Search(own, step_pool, tier, need, policy);
+        if(index >= 0) {
+            return own.hosts[index];
+        }
+    }
+    if(spill == nullptr) {
+        return NO_MACHINE;
+    }
+    for(unsigned step = 0; step < 4; step++) {
+        if(order[step][1] == 0) {
+            continue;
+        }
+        int index = Search(*spill, order[step][0] == 0 ? pool : other, 1, need, policy);
+        if(index >= 0) {
+            return spill->hosts[index];
+        }
+    }
+    return NO_MACHINE;
+}
+
+MachineId_t PlacementEngine::FindIdleCore(CPUType_t cpu, bool gpu, unsigned memory, FitPolicy_t policy) {
+    Group_t & group = GroupOf(cpu, gpu);
+    for(unsigned pool = 0; pool < POOLS; pool++) {
+        int index = Search(group, Pool_t(pool), 0, int64_t(memory), policy);
+        if(index >= 0) {
+            return group.hosts[index];
+        }
+    }
+    return NO_MACHINE;
+}
+
+MachineId_t PlacementEngine::FindRoom(CPUType_t cpu, bool gpu, unsigned memory, FitPolicy_t policy) {
+    MachineId_t machine_id = FindIdleCore(cpu, gpu, memory, policy);
+    Group_t & group = GroupOf(cpu, gpu);
+    for(unsigned pool = 0; pool < POOLS && machine_id == NO_MACHINE; pool++) {
+        int index = Search(group, Pool_t(pool), 1, int64_t(memory), policy);
+        if(index >= 0) {
+            machine_id = group.hosts[index];
+        }
+    }
+    return machine_id;
+}
@@ -0,0 +1,98 @@
+//
+//  Placement.hpp
+//  CloudSim
+//
+
+#ifndef Placement_hpp
+#define Placement_hpp
+
+#include <vector>
+
+#include "Interfaces.h"
+
+typedef enum {
+    FIRST_FIT,              // Lowest machine id that fits
+    BEST_FIT,               // Least memory left over, packs hosts tightly
+    WORST_FIT               // Most memory left over, spreads the load
+} FitPolicy_t;
+
+typedef enum {
+    LATENCY_POOL,           // Hosts that keep headroom for tight SLAs
+    BATCH_POOL              // Hosts that are packed with everything else
+} Pool_t;
+#define POOLS 2
+
+// Segment tree over a fixed set of hosts, keyed by free memory. Hosts that are not in
+// the tree hold no value. A node keeps the largest and smallest value below it and
+// where they are, which answers first, best and worst fit in about O(log n).
+class CapacityTree {
+public:
+    void            Resize(unsigned size);
+    void            Remove(unsigned index)                  { Set(index, ABSENT); }
+    void            Set(unsigned index, int64_t free_memory);
+    int             First(int64_t need) const;              // Index of the leftmost host with need free, -1 if none
+    int             Largest(int64_t need) const;            // Host with the most free memory, if at least need
+    int             Smallest(int64_t need) const;           // Host with the least free memory that is still at least need
+private:
+    static const int64_t ABSENT = -1;
+    typedef struct {
+        int64_t     max;
+        int64_t     min;            // INT64_MAX when no host is below the node
+        unsigned    arg_max;
+        unsigned    arg_min;
+    } Node_t;
+
+    void            Pull(unsigned node);
+    int             Smallest(unsigned node, int64_t need) const;
+
+    vector<Node_t>  nodes;
+    unsigned        leaves = 0;
+};
+
+// Picks the host for a new task across three dimensions. CPU type and memory are hard
+// constraints, and so is a GPU for a GPU capable task. Hosts that still have an idle
+// core (fewer tasks than cores) come before hosts that would be oversubscribed. Within
+// that order the fit policy chooses by free memory.
+//
+// GPU hosts are kept for GPU capable tasks. A task that cannot use a GPU spills onto
+// an idle core of a GPU host only where the hosts without one would have to be
+// oversubscribed, and onto an oversubscribed GPU host only when nothing else fits.
+//
+// Hosts are compared in the order given to Init(), by machine id if there is none: first
+// fit takes the earliest host that fits, and best and worst fit break ties the same way.
+//
+// Init() can set aside a percentage of the hosts of every group as the latency pool.
+// A search for the latency pool takes an idle core anywhere before oversubscribing a
+// host, trying the latency pool first. A search for the batch pool fills the batch
+// hosts, oversubscribed or not, and only then spills onto the latency pool. Without a
+// reserve every host is in the batch pool.
+//
+// Hosts are grouped by CPU type and GPU, and every group has one tree per pool for the
+// hosts with an idle core and one for the rest. The index is refreshed through Update(),
+// which the scheduler calls for the machines it changes and for those in MachineDeltas().
+// A host whose entry went stale in between is checked against the machine before it is
+// returned, and re-filed if it no longer fits.
+class PlacementEngine {
+public:
+    void            Init(bool (*eligible)(MachineId_t machine_id), unsigned reserve_percent = 0, const vector<MachineId_t> & order = vector<MachineId_t>());
+    MachineId_t     Find(TaskId_t task_id, FitPolicy_t policy, Pool_t pool = BATCH_POOL);
+    MachineId_t     FindIdleCore(CPUType_t cpu, bool gpu, unsigned memory, FitPolicy_t policy);    // Host with an idle core and memory free, in either pool
+    MachineId_t     FindRoom(CPUType_t cpu, bool gpu, unsigned memory, FitPolicy_t policy);        // Host with memory free, one with an idle core if there is
+    Pool_t          PoolOf(MachineId_t machine_id) const    { return pools[machine_id]; }
+    void            Update(MachineId_t machine_id);
+private:
+    typedef struct {
+        vector<MachineId_t> hosts;
+        CapacityTree trees[POOLS][2];   // [pool][0] hosts with an idle core, [pool][1] oversubscribed hosts
+    } Group_t;
+
+    Group_t &       GroupOf(CPUType_t cpu, bool gpu)        { return groups[unsigned(cpu) * 2 + (gpu ? 1 : 0)]; }
+    int             Search(Group_t & group, Pool_t pool, unsigned tier, int64_t need, FitPolicy_t policy);
+
+    bool            (*eligible)(MachineId_t machine_id) = nullptr;
+    vector<Group_t> groups;
+    vector<unsigned> position;      // Index of each machine within its group
+    vector<Pool_t>  pools;
+};
+
+#endif /* Placement_hpp */
@@ -0,0 +1,79 @@
+//
+//  Rescue.cpp
+//  CloudSim
+//
+
+#include <algorithm>
+
+#include "Rescue.hpp"
+
+void RescueIndex::Init(bool (*eligible)(MachineId_t machine_id)) {
+    this->eligible = eligible;
+    unsigned total = Machine_GetTotal();
+    levels.clear();
+    level_of.assign(total, 0);
+    filed.assign(total, -1);
+    for(MachineId_t machine_id = 0; machine_id < total; machine_id++) {
+        const MachineClassInfo_t & info = Machine_GetClassInfo(machine_id);
+        unsigned level = 0;
+        while(level < levels.size() && (levels[level].cpu != info.cpu || levels[level].gpus != info.gpus || levels[level].mips != info.performance[P0])) {
+            level++;
+        }
+        if(level == levels.size()) {
+            levels.push_back({info.cpu, info.gpus, info.performance[P0], {}});
+        }
+        level_of[machine_id] = level;
+    }
+    for(MachineId_t machine_id = 0; machine_id < total; machine_id++) {
+        Update(machine_id);
+    }
+}
+
+bool RescueIndex::Fits(MachineId_t machine_id, unsigned memory) const {
+    const MachineInfo_t & info = Machine_GetInfoRef(machine_id);
+    return eligible(machine_id) && info.active_tasks < info.num_cpus && uint64_t(info.memory_used) + memory <= info.memory_size;
+}
+
+void RescueIndex::Update(MachineId_t machine_id) {
+    const MachineInfo_t & info = Machine_GetInfoRef(machine_id);
+    set<pair<unsigned, MachineId_t> > & hosts = levels[level_of[machine_id]].hosts;
+    if(filed[machine_id] >= 0) {
+        hosts.erase({unsigned(filed[machine_id]), machine_id});
+        filed[machine_id] = -1;
+    }
+    if(eligible(machine_id) && info.active_tasks < info.num_cpus && info.memory_used < info.memory_size) {
+        filed[machine_id] = info.memory_size - info.memory_used;
+        hosts.insert({unsigned(filed[machine_id]), machine_id});
+    }
+}
+
+MachineId_t RescueIndex::Fastest(TaskId_t task_id, unsigned memory, bool gpu_hosts, MachineId_t exclude) {
+    const TaskInfo_t & task = GetTaskInfoRef(task_id);
+    vector<pair<uint64_t, unsigned> > order;        // {speed, level}
+    for(unsigned level = 0; level < levels.size(); level++) {
+        if(levels[level].cpu == task.required_cpu && (gpu_hosts || !levels[level].gpus)) {
+            uint64_t speed = uint64_t(levels[level].mips) * (task.gpu_capable && levels[level].gpus ? GPU_SPEEDUP : 1);
+            order.push_back({speed, level});
+        }
+    }
+    sort(order.begin(), order.end(), [](const pair<uint64_t, unsigned> & a, const pair<uint64_t, unsigned> & b) {
+        return a.first > b.first;
+    });
+    for(const pair<uint64_t, unsigned> & entry : order) {
+        set<pair<unsigned, MachineId_t> > & hosts = levels[entry.second].hosts;
+        auto it = hosts.lower_bound({memory, 0});
+        while(it != hosts.end()) {
+            MachineId_t machine_id = it->second;
+            it++;
+            if(machine_id == exclude) {
+                continue;
+            }
+            if(Fits(machine_id, memory)) {
+                return machine_id;
+            }
+            // The entry predates changes made since the last update
+            Update(machine_id);
+        }
+    }
+    return NO_MACHINE;
+}
@@ -0,0 +1,46 @@
+//
+//  Rescue.hpp
+//  CloudSim
+//
+
+#ifndef Rescue_hpp
+#define Rescue_hpp
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "Interfaces.h"
+
+// Finds the host where a task that is falling behind would finish first: an awake host
+// with an idle core, as fast as possible for the task. The speed of a host is the MIPS
+// of its cores at P0, times GPU_SPEEDUP for a GPU capable task on a GPU host. Hosts
+// are filed by CPU type and speed, and within that by free memory, so a query visits
+// the few speed levels of the task's CPU type from the fastest down and does one
+// O(log n) lookup in each, taking the host that fits the VM most tightly.
+//
+// Only hosts that the eligible callback accepts and that have an idle core are filed.
+// The index is refreshed through Update(), and a host whose entry went stale in between
+// is checked against the machine before it is returned, and re-filed.
+class RescueIndex {
+public:
+    void            Init(bool (*eligible)(MachineId_t machine_id));
+    MachineId_t     Fastest(TaskId_t task_id, unsigned memory, bool gpu_hosts, MachineId_t exclude);
+    void            Update(MachineId_t machine_id);
+private:
+    typedef struct {
+        CPUType_t   cpu;
+        bool        gpus;
+        unsigned    mips;
+        set<pair<unsigned, MachineId_t> > hosts;   // {free memory, machine}
+    } Level_t;
+
+    bool            Fits(MachineId_t machine_id, unsigned memory) const;
+
+    bool            (*eligible)(MachineId_t machine_id) = nullptr;
+    vector<Level_t> levels;
+    vector<unsigned> level_of;
+    vector<int64_t> filed;          // Free memory each machine is filed under, -1 if it is not
+};
+
+#endif /* Rescue_hpp */
@@ -6,6 +6,8 @@
 //
 
 #include "Scheduler.hpp"
+#include "Latency.hpp"
+#include "Standby.hpp"
 #include <assert.h>
 #include <stdio.h>
 #include <string>
@@ -16,6 +18,7 @@
 #include <stdexcept>
 
 #define TIMER_DECREMENT 100000
+#define STANDBY_PERIOD 100000
 
 static Scheduler Scheduler;
 static vector<MachineId_t> fully_on;
@@ -24,9 +27,29 @@ static vector<TaskId_t> task_queue;
 
 static unordered_map<MachineId_t, bool> changing_state;
 
+// Machines of each CPU type that stay fully on for the measured load, never fewer than
+// half of them: machines are not rebalanced, so a burst lands on whatever is on.
+static StandbyPlanner standby;
+static Time_t last_standby = 0;
+static LatencyStats latency;
+
 void lower_level();
 void increase_level(TaskId_t task_id);
 
+// GPU machines are kept for GPU capable tasks: those go to a GPU machine whenever one
+// fits, and anything else only takes an idle core on a GPU machine when the machines
+// without one have none left. Once every core is busy the load is spread as before.
+// Lower ranks are tried first.
+static unsigned gpu_pool_rank(const MachineInfo_t & machine, const TaskInfo_t & task) {
+    if (task.gpu_capable) {
+        return machine.gpus ? 0 : 1;
+    }
+    if (machine.active_tasks >= machine.num_cpus) {
+        return 2;
+    }
+    return machine.gpus ? 1 : 0;
+}
+
 void Scheduler::Init() {
     cout << "E-Eco Scheduler!" << endl;
     SimOutput("Scheduler::Init(): Total number of machines is " + to_string(Machine_GetTotal()), 3);
@@ -36,7 +59,7 @@ void Scheduler::Init() {
         fully_on.push_back(machine_id);
         changing_state[machine_id] = false;
     }
-
+    standby.Init(50);
 }
 
 void Scheduler::MigrationComplete(Time_t time, VMId_t vm_id) {
@@ -44,13 +67,14 @@ void Scheduler::MigrationComplete(Time_t time, VMId_t vm_id) {
 }
 
 void Scheduler::NewTask(Time_t now, TaskId_t task_id) {
-    TaskInfo_t task_info = GetTaskInfo(task_id);
+    const TaskInfo_t & task_info = GetTaskInfoRef(task_id);
+    standby.TaskArrived(task_id);
     VMId_t new_vm = VM_Create(task_info.required_vm, task_info.required_cpu);  
     bool found_first = false;
     MachineId_t best_option;
     // Find the machine with the smallest ultization (least amout of active tasks)
     for (MachineId_t id : fully_on) {
-        MachineInfo_t curr_machine = Machine_GetInfo(id);
+        const MachineInfo_t & curr_machine = Machine_GetInfoRef(id);
         if (curr_machine.cpu == task_info.required_cpu &&
                 curr_machine.memory_size - curr_machine.memory_used >= task_info.required_memory + 8 &&
                     !changing_state[id]) {
@@ -58,16 +82,13 @@ void Scheduler::NewTask(Time_t now, TaskId_t task_id) {
                 best_option = id;
                 found_first = true;
             } else {
-                MachineInfo_t best_option_machine = Machine_GetInfo(best_option);
-                if (curr_machine.active_tasks < best_option_machine.active_tasks) {
+                const MachineInfo_t & best_option_machine = Machine_GetInfoRef(best_option);
+                unsigned curr_rank = gpu_pool_rank(curr_machine, task_info);
+                unsigned best_rank = gpu_pool_rank(best_option_machine, task_info);
+                if (curr_rank < best_rank ||
+                        (curr_rank == best_rank && curr_machine.active_tasks < best_option_machine.active_tasks)) {
                     best_option = id;
                 }
-                
-                if (task_info.gpu_capable) {
-                    if (best_option_machine.gpus && !curr_machine.gpus) {
-                        best_option = best_option_machine.machine_id;
-                    }
-                }
             }
             // SimOutput("Match ID: " + to_string (best_option), 1);
         }
@@ -82,28 +103,53 @@ void Scheduler::NewTask(Time_t now, TaskId_t task_id) {
     
 }
 
+void Scheduler::NewTasks(Time_t now, const vector<TaskId_t> & task_ids) {
+    // A batch is placed one CPU type at a time, largest memory first
+    if (task_ids.size() == 1) {
+        NewTask(now, task_ids[0]);
+        return;
+    }
+    vector<TaskId_t> order(task_ids);
+    stable_sort(order.begin(), order.end(), [](TaskId_t a, TaskId_t b) {
+        const TaskInfo_t & a_info = GetTaskInfoRef(a);
+        const TaskInfo_t & b_info = GetTaskInfoRef(b);
+        if (a_info.required_cpu != b_info.required_cpu) {
+            return a_info.required_cpu < b_info.required_cpu;
+        }
+        return a_info.required_memory > b_info.required_memory;
+    });
+    for (TaskId_t task_id : order) {
+        NewTask(now, task_id);
+    }
+}
+
 void lower_level() {
+    vector<unsigned> on(CPU_TYPES, 0);
+    for (MachineId_t m_id : fully_on) {
+        on[Machine_GetCPUType(m_id)]++;
+    }
     for (int i = 0; i < fully_on.size(); i++) {
         if (fully_on.size() == 1)
             break;
-        if (idle.size() == Machine_GetTotal() * .5)
-            break;
         MachineId_t m_id = fully_on[i];
-        MachineInfo_t m_info = Machine_GetInfo(m_id);
-        if (!changing_state[m_id] && m_info.active_tasks == 0) {
+        CPUType_t cpu = Machine_GetCPUType(m_id);
+        if (on[cpu] <= standby.Hosts(cpu))
+            continue;
+        if (!changing_state[m_id] && Machine_GetActiveTasks(m_id) == 0) {
             Machine_SetState(m_id, S3);
             changing_state[m_id] = true;
             fully_on.erase(fully_on.begin() + i);
             idle.push_back(m_id);
+            on[cpu]--;
             i--;
         }
     }
 }
 
 void increase_level(TaskId_t task_id) {
-    TaskInfo_t task_info = GetTaskInfo(task_id);
+    const TaskInfo_t & task_info = GetTaskInfoRef(task_id);
     for (int i = 0; i < idle.size(); i++) {
-        MachineInfo_t idle_machine = Machine_GetInfo(idle[i]);
+        const MachineInfo_t & idle_machine = Machine_GetInfoRef(idle[i]);
         if (!changing_state[idle_machine.machine_id] && idle_machine.cpu == task_info.required_cpu 
                 && idle_machine.memory_size >= task_info.required_memory + 8) {
             Machine_SetState(idle_machine.machine_id, S0);
@@ -120,6 +166,27 @@ void Scheduler::PeriodicCheck(Time_t now) {
     // SchedulerCheck is called periodically by the simulator to allow you to monitor, make decisions, adjustments, etc.
     // Unlike the other invocations of the scheduler, this one doesn't report any specific event
     // Recommendation: Take advantage of this function to do some monitoring and adjustments as necessary
+    if (now - last_standby < STANDBY_PERIOD)
+        return;
+    last_standby = now;
+    standby.Evaluate(now);
+    // Bring idle machines back when the standby capacity grew
+    vector<unsigned> on(CPU_TYPES, 0);
+    for (MachineId_t m_id : fully_on) {
+        on[Machine_GetCPUType(m_id)]++;
+    }
+    for(size_t i = 0; i < idle.size(); i++) {
+        MachineId_t m_id = idle[i];
+        CPUType_t cpu = Machine_GetCPUType(m_id);
+        if (!changing_state[m_id] && on[cpu] < standby.Hosts(cpu)) {
+            Machine_SetState(m_id, S0);
+            changing_state[m_id] = true;
+            idle.erase(idle.begin() + i);
+            fully_on.push_back(m_id);
+            on[cpu]++;
+            i--;
+        }
+    }
 }
 
 void Scheduler::Shutdown(Time_t time) {
@@ -139,6 +206,7 @@ void Scheduler::TaskComplete(Time_t now, TaskId_t task_id) {
     // Decide if a machine is to be turned off, slowed down, or VMs to be migrated according to your policy
     // This is an opportunity to make any adjustments to optimize performance/energy
     SimOutput("Scheduler::TaskComplete(): Task " + to_string(task_id) + " is complete at " + to_string(now), 1);
+    standby.TaskCompleted(task_id);
     lower_level();
 }
 
@@ -149,13 +217,16 @@ void InitScheduler() {
     Scheduler.Init();
 }
 
-void HandleNewTask(Time_t time, TaskId_t task_id) {
-    SimOutput("HandleNewTask(): Received new task " + to_string(task_id) + " at time " + to_string(time), 4);
-    Scheduler.NewTask(time, task_id);
+void HandleNewTasks(Time_t time, const vector<TaskId_t> & task_ids) {
+    for (TaskId_t task_id : task_ids) {
+        SimOutput("HandleNewTask(): Received new task " + to_string(task_id) + " at time " + to_string(time), 4);
+    }
+    Scheduler.NewTasks(time, task_ids);
 }
 
 void HandleTaskCompletion(Time_t time, TaskId_t task_id) {
     SimOutput("HandleTaskCompletion(): Task " + to_string(task_id) + " completed at time " + to_string(time), 4);
+    latency.TaskCompleted(task_id);
     Scheduler.TaskComplete(time, task_id);
 }
 
@@ -171,6 +242,12 @@ void MigrationDone(Time_t time, VMId_t vm_id) {
 
 }
 
+void MachineDeltas(Time_t time, const vector<MachineDelta_t> & deltas) {
+    // The simulator reports the machines whose memory, tasks, VMs or S state changed
+    // during the last event. This policy probes the machines when it places work, so
+    // there is no index to keep up to date.
+}
+
 void SchedulerCheck(Time_t time) {
     // This function is called periodically by the simulator, no specific event
     SimOutput("SchedulerCheck(): SchedulerCheck() called at " + to_string(time), 4);
@@ -186,11 +263,18 @@ void SimulationComplete(Time_t time) {
     cout << "SLA2: " << GetSLAReport(SLA2) << "%" << endl;     // SLA3 do not have SLA violation issues
     cout << "Total Energy " << Machine_GetClusterEnergy() << "KW-Hour" << endl;
     cout << "Simulation run finished in " << double(time)/1000000 << " seconds" << endl;
+    latency.Report();
     SimOutput("SimulationComplete(): Simulation finished at time " + to_string(time), 4);
     
     Scheduler.Shutdown(time);
 }
 
+void SimulationForked(Time_t time, unsigned variant) {
+    // The run goes on in several variants from here. This policy has no parameters to
+    // vary, so all variants carry on alike.
+    SimOutput("SimulationForked(): Variant " + to_string(variant) + " at time " + to_string(time), 1);
+}
+
 void SLAWarning(Time_t time, TaskId_t task_id) {
     increase_level (task_id);
 }
@@ -202,7 +286,7 @@ void StateChangeComplete(Time_t time, MachineId_t machine_id) {
     if (m_info.s_state == S0) {
         for (int i = 0; i < task_queue.size(); i++) {
             TaskId_t t_id = task_queue[i];
-            TaskInfo_t t_info = GetTaskInfo(t_id);
+            const TaskInfo_t & t_info = GetTaskInfoRef(t_id);
             if (t_info.required_cpu == m_info.cpu &&
                 m_info.memory_size - m_info.memory_used >= t_info.required_memory + 8) {
                 
@@ -1,5 +1,12 @@
 //Greedy Scheduler
 #include "Scheduler.hpp"
+#include "Eviction.hpp"
+#include "Latency.hpp"
+#include "LoadModel.hpp"
+#include "Placement.hpp"
+#include "Rescue.hpp"
+#include "Standby.hpp"
+#include "Surrogate.hpp"
 #include <assert.h>
 #include <stdio.h>
 #include <string>
@@ -15,10 +22,12 @@ static uint64_t tasks_completed = 0;
 
 
 
-//track migrating VMs
-static unordered_set<VMId_t> migrating_VMs;
-//keep track so we never power gate this
-static unordered_set<MachineId_t> migration_destinations;
+//track migrating VMs, with the PM each one leaves
+static unordered_map<VMId_t, MachineId_t> migrating_VMs;
+//the VMs on each PM by id, a migrating VM stays with the PM it leaves until it lands
+static vector<vector<VMId_t>> vms_on;
+//keep track so we never power gate this, one entry per VM on its way
+static unordered_multiset<MachineId_t> migration_destinations;
 
 //track which machines are between states
 static unordered_map<MachineId_t, bool> changing_state;
@@ -28,14 +37,59 @@ static unordered_map<MachineId_t, bool> changing_state;
 //so we need to create these when the Machine done setting state to S0
 static vector<TaskId_t> wakeup_tasks;
 
-//for the actual SLA routine, when it looks for PMs on standby to migrate to.
-static vector<VMId_t> wakeup_migrations;
-
 //tracks which PMs have not been put to sleep or ordered to put to sleep
 static set<MachineId_t> awake;
 static unordered_map<TaskId_t, VMId_t> task_to_vm;
 //when we migrate, we must reserve memory to avoid overflow
 static unordered_map<MachineId_t, unsigned> reserved_mem;
+//index of the awake PMs that new tasks can go to
+static PlacementEngine placement;
+//predicted CPU share and finish time of the tasks we placed
+static LoadModel load;
+//how new tasks pick among the PMs that fit, forked variants of a run try the others
+static FitPolicy_t placement_policy = BEST_FIT;
+//SLA tiers: SLA0/SLA1 tasks go to a pool of PMs that keeps headroom, everything
+//else is packed onto the other PMs, which slow down while they only run SLA3 work
+static const bool SLA_TIERS = true;
+static const unsigned LATENCY_RESERVE = 25;                 //percent of the PMs of each kind
+static const FitPolicy_t LATENCY_POLICY = WORST_FIT;
+static const CPUPerformance_t BATCH_P_STATE = P1;
+static const Time_t PRIORITY_REVIEW_PERIOD = 1000000;       //how often SLA2 tasks are checked, in us
+//SLA2 tasks still at MID_PRIORITY, promoted when they are about to miss their target
+static unordered_set<TaskId_t> mid_tasks;
+static Time_t last_review = 0;
+//GPU pool: GPU hosts are kept for GPU capable tasks. Every AI_TRAINING or
+//SCIENTIFIC task that finds no idle core on the GPU hosts of its CPU moves one
+//CPU-only VM off those hosts at the next review. The other classes are short or
+//not compute bound, so they take a GPU core when one is idle but are not worth a
+//migration
+static const Time_t GPU_REVIEW_PERIOD = 1000000;           //in us
+static vector<MachineId_t> gpu_hosts[CPU_TYPES];
+static unsigned gpu_shortfall[CPU_TYPES];
+static Time_t last_gpu_review = 0;
+//SLA rescue: the fastest awake PMs with an idle core, and when each PM was last
+//looked at after an SLA warning
+static RescueIndex rescue;
+static const Time_t RESCUE_PERIOD = 1000000;               //in us
+static unordered_map<MachineId_t, Time_t> last_rescue;
+//standby capacity: how many PMs of each CPU type stay up for the measured load,
+//and how many are up or waking up. PMs are only kept up, never woken for it:
+//a PM woken ahead of the load is packed over and goes straight back down
+static StandbyPlanner standby;
+static const Time_t STANDBY_PERIOD = 100000;               //in us
+static Time_t last_standby = 0;
+static LatencyStats latency;                              //stretch and latency of completed tasks
+static unsigned powered[CPU_TYPES];
+//consolidation: every MPC_PERIOD a surrogate of the cluster prices draining the
+//least loaded PMs, moving a VM off the most crowded ones, stepping the P-state
+//of latency PMs and putting empty PMs to sleep, and the actions that pay off
+//most are taken, one after the other
+static ClusterSurrogate surrogate;
+static const Time_t MPC_PERIOD = 1000000;                  //in us
+static const unsigned MPC_CANDIDATES = 4;                  //PMs tried for each kind of move
+static const unsigned MPC_ACTIONS = 2;                     //per round
+static const double MPC_MARGIN = 1.0;                      //least gain worth acting on, in units of power
+static Time_t last_mpc = 0;
 
 static Priority_t sla_to_priority(SLAType_t sla);
 static void print_vm_info(VMId_t vm);
@@ -58,12 +112,37 @@ static string sla_tostring(SLAType_t sla);
 struct MachineUtilComparator{
     bool operator()(MachineId_t a, MachineId_t b) const
     {
-        return Machine_GetInfo(a).active_tasks < Machine_GetInfo(b).active_tasks;
+        return Machine_GetActiveTasks(a) < Machine_GetActiveTasks(b);
     }
 };
 
 
 
+/**
+ * Helper function, returns true if new tasks can be placed on a PM right now,
+ * i.e. it is awake and not in the middle of a state change
+ */
+static bool Placeable(MachineId_t machine_id){
+    return awake.count(machine_id) > 0 && !changing_state[machine_id];
+}
+
+/**
+ * Helper function for the surrogate, returns true if a VM can be moved, i.e.
+ * it is not migrating already
+ */
+static bool Movable(VMId_t vm_id){
+    return migrating_VMs.count(vm_id) == 0;
+}
+
+/**
+ * Helper function for the surrogate, returns true if a PM that has been
+ * emptied may go to sleep without eating into the standby capacity
+ */
+static bool MaySleep(MachineId_t machine_id){
+    CPUType_t cpu = Machine_GetCPUType(machine_id);
+    return migration_destinations.count(machine_id) == 0 && powered[cpu] > standby.Hosts(cpu);
+}
+
 /**
  * Runs on startup, initializes parameters/data structures
  */
@@ -76,25 +155,52 @@ void Scheduler::Init() {
     for(unsigned i = 0; i < Machine_GetTotal(); i++) {
         MachineId_t machine_id = MachineId_t(i);
         this->machines.push_back(machine_id);
-        MachineInfo_t machine_info = Machine_GetInfo(machine_id);
         //queue empty initially
         awake.insert(machine_id);
         changing_state[machine_id] = false;
+        powered[Machine_GetCPUType(machine_id)]++;
+        if(Machine_GetInfoRef(machine_id).gpus){
+            gpu_hosts[Machine_GetCPUType(machine_id)].push_back(machine_id);
+        }
         //dump info
         // print_machine_info(this->machines[i]);
     }
+    vms_on.resize(Machine_GetTotal());
+    placement.Init(Placeable, SLA_TIERS ? LATENCY_RESERVE : 0);
+    load.Init();
+    rescue.Init(Placeable);
+    standby.Init(0);
+    surrogate.Init(Movable, MaySleep);
 }
 
 static bool IsMigrating(VMId_t vm_id){
     return migrating_VMs.count(vm_id) > 0;
 }
 
+/**
+ * Helper function, records that a VM is on a PM. VM ids grow as VMs are
+ * created, so keeping the VMs of a PM sorted visits them in the order of
+ * Scheduler.vms.
+ */
+static void AddVMTo(VMId_t vm_id, MachineId_t machine_id){
+    vector<VMId_t> & on = vms_on[machine_id];
+    on.insert(lower_bound(on.begin(), on.end(), vm_id), vm_id);
+}
+
+/**
+ * Helper function, records that a VM left a PM or shut down
+ */
+static void RemoveVMFrom(VMId_t vm_id, MachineId_t machine_id){
+    vector<VMId_t> & on = vms_on[machine_id];
+    on.erase(lower_bound(on.begin(), on.end(), vm_id));
+}
+
 bool CPUCompatible(MachineId_t machine_id, TaskId_t task_id){
-    return Machine_GetCPUType(machine_id) == GetTaskInfo(task_id).required_cpu;
+    return Machine_GetCPUType(machine_id) == RequiredCPUType(task_id);
 }
 
 bool TaskMemoryFits(MachineId_t machine_id, TaskId_t task_id){
-    MachineInfo_t info = Machine_GetInfo(machine_id);
+    const MachineInfo_t & info = Machine_GetInfoRef(machine_id);
     return GetTaskMemory(task_id) + info.memory_used + VM_MEMORY_OVERHEAD <= info.memory_size;
 }
 
@@ -107,8 +213,8 @@ bool IsAwake(MachineId_t machine){
  * it needs the gpu and the machine has a GPU)
  */
 bool GPUCompatible(MachineId_t machine_id, TaskId_t task_id){
-    MachineInfo_t machine_info = Machine_GetInfo(machine_id);
-    TaskInfo_t task_info = GetTaskInfo(task_id);
+    const MachineInfo_t & machine_info = Machine_GetInfoRef(machine_id);
+    const TaskInfo_t & task_info = GetTaskInfoRef(task_id);
     return !task_info.gpu_capable || (task_info.gpu_capable && machine_info.gpus);
 }
 
@@ -125,12 +231,16 @@ bool Scheduler::TryShutdown(MachineId_t machine_id){
     if(migration_destinations.count(machine_id) > 0 || !IsAwake(machine_id) || changing_state[machine_id]){
         return false;
     }
-    MachineInfo_t machine_info = Machine_GetInfo(machine_id);
+    //keep the standby capacity up
+    CPUType_t cpu = Machine_GetCPUType(machine_id);
+    if(powered[cpu] <= standby.Hosts(cpu)){
+        return false;
+    }
     //make sure we don't have active VMs
-    bool safe_shutdown = machine_info.active_vms == 0;
-    //make sure we dono't have migrating VMs
+    bool safe_shutdown = Machine_GetActiveVMs(machine_id) == 0;
+    //make sure no VM is still migrating off this PM
     if(safe_shutdown){
-        for(VMId_t vm : this->vms){
+        for(VMId_t vm : vms_on[machine_id]){
             if(IsMigrating(vm)){
                 safe_shutdown = false;
                 break;
@@ -139,6 +249,7 @@ bool Scheduler::TryShutdown(MachineId_t machine_id){
     }
     if(safe_shutdown){
         awake.erase(awake.find(machine_id));
+        powered[cpu]--;
         // cout << "shutting down machine " << machine_id << endl;
         Machine_SetState(machine_id, S5);
         changing_state[machine_id] = true;
@@ -149,6 +260,58 @@ bool Scheduler::TryShutdown(MachineId_t machine_id){
 }
 
 
+/**
+ * Helper function, sets a batch PM to BATCH_P_STATE while it only runs SLA3
+ * work and back to P0 as soon as anything else lands on it
+ * @param machine_id the PM whose tasks changed
+ */
+static void TuneBatchHost(MachineId_t machine_id){
+    const MachineInfo_t & info = Machine_GetInfoRef(machine_id);
+    if(!SLA_TIERS || placement.PoolOf(machine_id) != BATCH_POOL || info.s_state != S0){
+        return;
+    }
+    bool batch_only = load.Tasks(machine_id, LOW_PRIORITY) > 0
+        && load.Tasks(machine_id, HIGH_PRIORITY) + load.Tasks(machine_id, MID_PRIORITY) == 0;
+    CPUPerformance_t p_state = batch_only ? BATCH_P_STATE : P0;
+    if(info.p_state != p_state){
+        Machine_SetCorePerformance(machine_id, 0, p_state);
+    }
+}
+
+/**
+ * Helper function, starts a task on a PM in a fresh VM. With SLA tiers the
+ * task runs at the priority of its SLA.
+ * @param task_id the task to start
+ * @param machine_id the PM to start it on, awake and with room for it
+ */
+static void StartTask(TaskId_t task_id, MachineId_t machine_id){
+    const TaskInfo_t & task_info = GetTaskInfoRef(task_id);
+    Priority_t priority = SLA_TIERS ? sla_to_priority(task_info.required_sla) : task_info.priority;
+    VMId_t new_vm = VM_Create(task_info.required_vm, task_info.required_cpu);
+    Scheduler.vms.push_back(new_vm);
+    VM_Attach(new_vm, machine_id);
+    AddVMTo(new_vm, machine_id);
+    VM_AddTask(new_vm, task_id, priority);
+    task_to_vm[task_id] = new_vm;
+    load.TaskAdded(task_id, machine_id);
+    if(SLA_TIERS && priority == MID_PRIORITY){
+        mid_tasks.insert(task_id);
+    }
+    TuneBatchHost(machine_id);
+}
+
+
+/**
+ * Helper function, asks an asleep PM to wake up
+ * @param machine_id the PM, not awake and not changing state
+ */
+static void WakeUp(MachineId_t machine_id){
+    Machine_SetState(machine_id, S0);
+    changing_state[machine_id] = true;
+    powered[Machine_GetCPUType(machine_id)]++;
+}
+
+
 static void NewTaskAllocationSLA(TaskId_t task_id){
      //sort all PMs in order of utilization
 
@@ -161,7 +324,6 @@ static void NewTaskAllocationSLA(TaskId_t task_id){
     //TODO: change to prioritize awake PMs
     for(unsigned i = 0; i < Scheduler.machines.size(); i++){
         MachineId_t potential_dest = Scheduler.machines[i];
-        MachineInfo_t dest_info = Machine_GetInfo(potential_dest);
         if(CPUCompatible(potential_dest, task_id) 
                 && TaskMemoryFits(potential_dest, task_id)){
             dest = potential_dest;
@@ -172,16 +334,10 @@ static void NewTaskAllocationSLA(TaskId_t task_id){
 
     //destination machine found. migrate the task there.
     if(found){
-        MachineInfo_t dest_info = Machine_GetInfo(dest);
         if(IsAwake(dest) && !changing_state[dest]){
             //Since this happens with a new task, we don't migrate.
             //Instead, we create a new VM
-            TaskInfo_t task_info = GetTaskInfo(task_id);
-            VMId_t new_vm = VM_Create(task_info.required_vm, dest_info.cpu);
-            Scheduler.vms.push_back(new_vm);
-            VM_Attach(new_vm, dest);
-            VM_AddTask(new_vm, task_id, task_info.priority);
-            task_to_vm[task_id] = new_vm;
+            StartTask(task_id, dest);
         } else{
             //we couldn't find an awake machine, put it on the queue
             //and when a machine wakes up, it will try to allocate it
@@ -189,8 +345,7 @@ static void NewTaskAllocationSLA(TaskId_t task_id){
             //try to wake up machine if possible
             if(!changing_state[dest]){
                 // cout << "[newtaskallocsla] request to turn on machine " << dest << endl;
-                Machine_SetState(dest, S0);
-                changing_state[dest] = true;
+                WakeUp(dest);
                 // cout << "changing_state[" << dest << "] true" << endl;
             }
         }
@@ -204,32 +359,33 @@ static void NewTaskAllocationSLA(TaskId_t task_id){
 
 
 /**
- * Runs whenever a new task is scheduled. This function operates according to
- * the greedy algorithm, which finds the 1st available machine to attach the
- * task to based on utilization.
- * @param now the time of the task
- * @param task_id the ID of the new task that we want to schedule
+ * Finds a machine for a new task and attaches it in a fresh VM, falling back
+ * to the SLA routine when no awake machine fits.
+ * @return true if the task was attached right away
  */
-void Scheduler::NewTask(Time_t now, TaskId_t task_id) {
+static bool PlaceTask(TaskId_t task_id) {
     total_tasks++;
-    TaskInfo_t task_info = GetTaskInfo(task_id);
+    standby.TaskArrived(task_id);
+    const TaskInfo_t & task_info = GetTaskInfoRef(task_id);
     bool found_machine = false;
-    //1st pass: awake machines
-    for(MachineId_t machine_id : this->machines){
-        MachineInfo_t machine_info = Machine_GetInfo(machine_id);
-        //make sure machine is awake and meets requirements
-        if(CPUCompatible(machine_id, task_id) 
-            && TaskMemoryFits(machine_id, task_id)
-                && GPUCompatible(machine_id, task_id)
-                    && IsAwake(machine_id) && !changing_state[machine_id]){
-            VMId_t new_vm = VM_Create(task_info.required_vm, task_info.required_cpu);
-            this->vms.push_back(new_vm);
-            VM_Attach(new_vm, machine_id);
-            VM_AddTask(new_vm, task_id, task_info.priority);
-            task_to_vm[task_id] = new_vm;
-            found_machine = true;
-            break;
-        }
+    //1st pass: awake machines, through the placement index
+    MachineId_t machine_id = NO_MACHINE;
+    if(SLA_TIERS && task_info.required_sla <= SLA1){
+        machine_id = placement.Find(task_id, LATENCY_POLICY, LATENCY_POOL);
+    } else{
+        machine_id = placement.Find(task_id, placement_policy, BATCH_POOL);
+    }
+    //a long GPU capable task without an idle GPU core asks for room on the GPU hosts
+    CPUType_t cpu = task_info.required_cpu;
+    if(task_info.gpu_capable && (task_info.task_class == AI_TRAINING || task_info.task_class == SCIENTIFIC)
+            && !gpu_hosts[cpu].empty()
+            && placement.FindIdleCore(cpu, true, task_info.required_memory + VM_MEMORY_OVERHEAD, placement_policy) == NO_MACHINE){
+        gpu_shortfall[cpu]++;
+    }
+    if(machine_id != NO_MACHINE){
+        StartTask(task_id, machine_id);
+        placement.Update(machine_id);
+        found_machine = true;
     }
 
 
@@ -237,7 +393,53 @@ void Scheduler::NewTask(Time_t now, TaskId_t task_id) {
     if(!found_machine){
         // cout << "couldn't find machine on 1st pass in newtask" << endl;
         NewTaskAllocationSLA(task_id);
-    } else{
+    }
+    return found_machine;
+}
+
+
+/**
+ * Runs whenever a new task is scheduled. This function operates according to
+ * the greedy algorithm, which finds the 1st available machine to attach the
+ * task to based on utilization.
+ * @param now the time of the task
+ * @param task_id the ID of the new task that we want to schedule
+ */
+void Scheduler::NewTask(Time_t now, TaskId_t task_id) {
+    if(PlaceTask(task_id)){
+        //turn unused PMs off
+        for(MachineId_t machine_id : this->machines){
+            TryShutdown(machine_id);
+        }
+    }
+}
+
+/**
+ * Runs when several tasks arrive together. The tasks are placed one CPU type
+ * at a time, largest memory first, and unused PMs are swept once for the
+ * whole batch instead of once per task.
+ * @param now the time of the tasks
+ * @param task_ids the IDs of the new tasks
+ */
+void Scheduler::NewTasks(Time_t now, const vector<TaskId_t> & task_ids) {
+    if(task_ids.size() == 1){
+        NewTask(now, task_ids[0]);
+        return;
+    }
+    vector<TaskId_t> order(task_ids);
+    stable_sort(order.begin(), order.end(), [](TaskId_t a, TaskId_t b){
+        const TaskInfo_t & a_info = GetTaskInfoRef(a);
+        const TaskInfo_t & b_info = GetTaskInfoRef(b);
+        if(a_info.required_cpu != b_info.required_cpu){
+            return a_info.required_cpu < b_info.required_cpu;
+        }
+        return a_info.required_memory > b_info.required_memory;
+    });
+    bool placed = false;
+    for(TaskId_t task_id : order){
+        placed = PlaceTask(task_id) || placed;
+    }
+    if(placed){
         //turn unused PMs off
         for(MachineId_t machine_id : this->machines){
             TryShutdown(machine_id);
@@ -247,6 +449,24 @@ void Scheduler::NewTask(Time_t now, TaskId_t task_id) {
 
 
 
+/**
+ * Helper function for the GPU pool, returns true if moving a VM to a PM keeps
+ * GPU capable work on the GPU hosts and CPU-only work off them
+ * @param vm_id the ID of the VM we want to migrate
+ * @param machine_id the ID of the machine we want to migrate to
+ */
+static bool GPUPoolAllows(VMId_t vm_id, MachineId_t machine_id){
+    const VMInfo_t & vm_info = VM_GetInfoRef(vm_id);
+    bool gpu_work = false;
+    for(TaskId_t task_id : vm_info.active_tasks){
+        gpu_work = gpu_work || GetTaskInfoRef(task_id).gpu_capable;
+    }
+    bool from_gpu = Machine_GetInfoRef(vm_info.machine_id).gpus;
+    bool to_gpu = Machine_GetInfoRef(machine_id).gpus;
+    return gpu_work ? to_gpu || !from_gpu : !to_gpu || from_gpu;
+}
+
+
 /**
  * Return true if it is possible to migrate a VM to a given machine.
  * This is determined by memory/CPU requirements, as well as the fact that
@@ -256,66 +476,41 @@ void Scheduler::NewTask(Time_t now, TaskId_t task_id) {
  * @return true if we can migrate, false otherwise.
  */
 static bool CanMigrateVM(VMId_t vm_id, MachineId_t machine_id){
-    VMInfo_t vm_info = VM_GetInfo(vm_id);
-    MachineInfo_t machine_info = Machine_GetInfo(machine_id);
+    const VMInfo_t & vm_info = VM_GetInfoRef(vm_id);
+    const MachineInfo_t & machine_info = Machine_GetInfoRef(machine_id);
     if(changing_state[machine_id] || !IsAwake(machine_id)
-        || vm_info.cpu != machine_info.cpu || IsMigrating(vm_id)){
+        || vm_info.cpu != machine_info.cpu || IsMigrating(vm_id)
+        || !GPUPoolAllows(vm_id, machine_id)){
         return false;
     }
-    unsigned total_vm_mem = VM_MEMORY_OVERHEAD;
-    for(TaskId_t task : vm_info.active_tasks){
-        total_vm_mem += GetTaskMemory(task);
-    }
+    unsigned total_vm_mem = VM_GetMemoryFootprint(vm_id);
     return total_vm_mem + machine_info.memory_used + reserved_mem[machine_id] < machine_info.memory_size;
 }
 
 
 
 /**
- * Runs whenever a task is completed. This is done according to the greedy
- * algorithm. We try to move tasks from the PM that the completed task
- * was located on to more utilized PMs to consolidate.
+ * Runs whenever a task is completed. The PMs it leaves room on are consolidated
+ * by the next round of Consolidate(), which weighs every move against what it
+ * costs instead of moving VMs to any PM that is more utilized.
  */
 void Scheduler::TaskComplete(Time_t now, TaskId_t task_id) {
     tasks_completed++;
+    standby.TaskCompleted(task_id);
+    load.TaskRemoved(task_id);
+    mid_tasks.erase(task_id);
     //shut down the VM that task_id is located in. 
     VMId_t task_vm = task_to_vm[task_id];
+    task_to_vm.erase(task_id);
+    TuneBatchHost(VM_GetInfoRef(task_vm).machine_id);
     if(IsMigrating(task_vm)){
         return;
     }
+    RemoveVMFrom(task_vm, VM_GetInfoRef(task_vm).machine_id);
     VM_Shutdown(task_vm);
     this->vms.erase(remove(this->vms.begin(), this->vms.end(), task_vm), this->vms.end());
     
     SimOutput("Scheduler::TaskComplete(): Task " + to_string(task_id) + " is complete at " + to_string(now), 4);
-    std::sort(this->machines.begin(), this->machines.end(), MachineUtilComparator());
-    for(unsigned j = 0; j < this->machines.size(); j++){
-        MachineId_t src_pm = this->machines[j];
-        if(IsAwake(src_pm) && !changing_state[src_pm]
-            && Machine_GetInfo(src_pm).active_vms > 0){
-            
-            //migrate workloads to more utilized machines if possible
-            for(VMId_t src_VM : this->vms){
-                VMInfo_t src_vm_info = VM_GetInfo(src_VM);
-                for(unsigned k = j + 1; k < this->machines.size(); k++){
-                    MachineId_t potential = this->machines[k];
-                    if(IsAwake(potential) && !changing_state[potential]  && CanMigrateVM(src_VM, potential)){
-                        migrating_VMs.insert(src_VM);
-                        // cout << "[task complete] migrating VM " << src_VM << " to machine " << potential << endl;
-                        unsigned needed_mem = VM_MEMORY_OVERHEAD;
-                        for(TaskId_t task : src_vm_info.active_tasks){
-                            needed_mem += GetTaskMemory(task);
-                        }
-                        // cout << "adding to reserved mem " << needed_mem << endl;
-                        reserved_mem[potential] += needed_mem;
-                        VM_Migrate(src_VM, potential);
-                        //calculate the memory we need to reserve on the machine
-                        migration_destinations.insert(potential);
-                        break;
-                    }
-                }
-            }
-        }
-    }
 }
 
 
@@ -333,22 +528,24 @@ void Scheduler::TaskComplete(Time_t now, TaskId_t task_id) {
 void Scheduler::MigrationComplete(Time_t time, VMId_t vm_id) {
     // cout << "fin moving VM " << vm_id << " to machine " << VM_GetInfo(vm_id).machine_id << endl;
     //update metadata structures
-    VMInfo_t vm_info = VM_GetInfo(vm_id);
+    const VMInfo_t & vm_info = VM_GetInfoRef(vm_id);
 
     MachineId_t dest_loc = vm_info.machine_id;
-    unsigned vm_mem = 0;
-    for(TaskId_t task : vm_info.active_tasks){
-        vm_mem += GetTaskMemory(task);
-    }
+    unsigned vm_mem = VM_GetMemoryFootprint(vm_id) - VM_MEMORY_OVERHEAD;
 
     // cout << "removing from reserved mem " << vm_mem << endl;
     reserved_mem[dest_loc] -= vm_mem;
-    migration_destinations.erase(dest_loc);
+    migration_destinations.erase(migration_destinations.find(dest_loc));
+    RemoveVMFrom(vm_id, migrating_VMs[vm_id]);
+    AddVMTo(vm_id, dest_loc);
     migrating_VMs.erase(vm_id);
+    load.VMMoved(vm_id, dest_loc);
+    TuneBatchHost(dest_loc);
 
     //the task might have completed while the VM was migrating. If this is the
     //case, we shut down here when we're done
     if(vm_info.active_tasks.size() == 0){
+        RemoveVMFrom(vm_id, dest_loc);
         VM_Shutdown(vm_id);
         this->vms.erase(remove(this->vms.begin(), this->vms.end(), vm_id), this->vms.end());
     }
@@ -356,13 +553,294 @@ void Scheduler::MigrationComplete(Time_t time, VMId_t vm_id) {
 
 
 
+/**
+ * Helper function for the GPU pool, moves CPU-only VMs off the GPU hosts of a
+ * CPU type, one for every task that asked for room on them since the last
+ * call. Only the VMs on those hosts are looked at. A VM only moves to an idle
+ * core on a PM without a GPU, and one VM goes to each PM per call since the
+ * index only sees the VM once it has arrived.
+ * @param cpu the CPU type whose GPU hosts are short of idle cores
+ */
+static void ReclaimGPUHosts(CPUType_t cpu){
+    unordered_set<MachineId_t> destinations;
+    for(MachineId_t machine_id : gpu_hosts[cpu]){
+        for(VMId_t vm_id : vms_on[machine_id]){
+            if(gpu_shortfall[cpu] == 0){
+                return;
+            }
+            const VMInfo_t & vm_info = VM_GetInfoRef(vm_id);
+            if(vm_info.active_tasks.empty() || IsMigrating(vm_id)){
+                continue;
+            }
+            bool cpu_only = true;
+            for(TaskId_t task_id : vm_info.active_tasks){
+                cpu_only = cpu_only && !GetTaskInfoRef(task_id).gpu_capable;
+            }
+            if(!cpu_only){
+                continue;
+            }
+            unsigned needed_mem = VM_GetMemoryFootprint(vm_id);
+            MachineId_t dest = placement.FindIdleCore(cpu, false, needed_mem, placement_policy);
+            if(dest == NO_MACHINE || destinations.count(dest) > 0 || !CanMigrateVM(vm_id, dest)){
+                return;
+            }
+            destinations.insert(dest);
+            migrating_VMs[vm_id] = machine_id;
+            reserved_mem[dest] += needed_mem;
+            VM_Migrate(vm_id, dest);
+            migration_destinations.insert(dest);
+            gpu_shortfall[cpu]--;
+        }
+    }
+}
+
+
+/**
+ * Helper function, gives every task that is waiting for a PM one if it can. The
+ * task starts on an awake PM that fits it, or an asleep PM is woken up for it
+ * unless a PM that could take it is already changing state. A PM that went down
+ * while a task was waiting for it has to be asked again.
+ */
+static void ServeWaitingTasks(){
+    vector<TaskId_t>::iterator wakeup_task_it = wakeup_tasks.begin();
+    while(wakeup_task_it != wakeup_tasks.end()){
+        TaskId_t task_id = *wakeup_task_it;
+        MachineId_t asleep = NO_MACHINE;
+        bool pending = false;
+        bool started = false;
+        for(MachineId_t machine_id : Scheduler.machines){
+            if(!CPUCompatible(machine_id, task_id) || !TaskMemoryFits(machine_id, task_id)){
+                continue;
+            }
+            if(changing_state[machine_id]){
+                pending = true;
+            } else if(IsAwake(machine_id)){
+                StartTask(task_id, machine_id);
+                started = true;
+                break;
+            } else if(asleep == NO_MACHINE){
+                asleep = machine_id;
+            }
+        }
+        if(started){
+            wakeup_task_it = wakeup_tasks.erase(wakeup_task_it);
+            continue;
+        }
+        if(!pending && asleep != NO_MACHINE){
+            WakeUp(asleep);
+        }
+        wakeup_task_it++;
+    }
+}
+
+
+/**
+ * Helper function for the consolidation, finds the awake PM the surrogate
+ * would move a VM to, i.e. the one where the move lowers the cost the most
+ * @param vm_id the VM to move
+ * @param planned memory promised to the PMs by the moves planned so far
+ * @param delta set to the change in cost of the move
+ * @return the destination, NO_MACHINE if no PM has room for the VM
+ */
+static MachineId_t BestDestination(VMId_t vm_id, const unordered_map<MachineId_t, unsigned> & planned, double & delta){
+    MachineId_t source = VM_GetInfoRef(vm_id).machine_id;
+    unsigned needed_mem = VM_GetMemoryFootprint(vm_id);
+    MachineId_t best = NO_MACHINE;
+    for(MachineId_t machine_id : awake){
+        if(machine_id == source || !CanMigrateVM(vm_id, machine_id)){
+            continue;
+        }
+        auto promised = planned.find(machine_id);
+        const MachineInfo_t & machine_info = Machine_GetInfoRef(machine_id);
+        if(promised != planned.end()
+            && needed_mem + machine_info.memory_used + reserved_mem[machine_id] + promised->second >= machine_info.memory_size){
+            continue;
+        }
+        double move = surrogate.MoveDelta(vm_id, machine_id);
+        if(best == NO_MACHINE || move < delta){
+            best = machine_id;
+            delta = move;
+        }
+    }
+    return best;
+}
+
+/**
+ * Model-predictive consolidation. Rolls the surrogate forward under the
+ * candidate actions and takes the one that lowers the cost the most, up to
+ * MPC_ACTIONS times: empty PMs go to sleep, the MPC_CANDIDATES least loaded
+ * PMs are drained onto the others, the smallest VM of the MPC_CANDIDATES most
+ * crowded PMs moves, and latency PMs step their P-state up or down (batch PMs
+ * are left to TuneBatchHost). A PM takes part in one action a round at most,
+ * besides receiving VMs.
+ * @param now the current time
+ */
+static void Consolidate(Time_t now){
+    surrogate.Refresh(Scheduler.vms, now);
+    for(MachineId_t machine_id : Scheduler.machines){
+        if(Placeable(machine_id) && Machine_GetActiveVMs(machine_id) == 0 && surrogate.SleepDelta(machine_id) < -MPC_MARGIN){
+            Scheduler.TryShutdown(machine_id);
+        }
+    }
+    //awake PMs with work that can move, least loaded first
+    vector<MachineId_t> loaded;
+    for(MachineId_t machine_id : awake){
+        if(!changing_state[machine_id] && migration_destinations.count(machine_id) == 0 && surrogate.Tasks(machine_id) > 0){
+            loaded.push_back(machine_id);
+        }
+    }
+    stable_sort(loaded.begin(), loaded.end(), [](MachineId_t a, MachineId_t b){
+        return surrogate.Tasks(a) < surrogate.Tasks(b);
+    });
+    unordered_map<MachineId_t, vector<VMId_t> > hosted;
+    unordered_set<MachineId_t> pinned;
+    for(VMId_t vm_id : Scheduler.vms){
+        const VMInfo_t & vm_info = VM_GetInfoRef(vm_id);
+        if(IsMigrating(vm_id)){
+            pinned.insert(vm_info.machine_id);
+        } else if(!vm_info.active_tasks.empty()){
+            hosted[vm_info.machine_id].push_back(vm_id);
+        }
+    }
+    unordered_set<MachineId_t> touched;
+    for(unsigned action = 0; action < MPC_ACTIONS; action++){
+        double best = -MPC_MARGIN;
+        vector<pair<VMId_t, MachineId_t> > best_moves;
+        MachineId_t tuned = NO_MACHINE;
+        CPUPerformance_t tuned_state = P0;
+        //drain one of the least loaded PMs
+        for(unsigned i = 0; i < loaded.size() && i < MPC_CANDIDATES; i++){
+            MachineId_t source = loaded[i];
+            if(touched.count(source) > 0 || pinned.count(source) > 0){
+                continue;
+            }
+            size_t mark = surrogate.Mark();
+            unordered_map<MachineId_t, unsigned> planned;
+            vector<pair<VMId_t, MachineId_t> > moves;
+            double delta = 0.0;
+            for(VMId_t vm_id : hosted[source]){
+                double move = 0.0;
+                MachineId_t dest = BestDestination(vm_id, planned, move);
+                if(dest == NO_MACHINE){
+                    moves.clear();
+                    break;
+                }
+                delta += move;
+                surrogate.Move(vm_id, dest);
+                planned[dest] += VM_GetMemoryFootprint(vm_id);
+                moves.push_back({vm_id, dest});
+            }
+            surrogate.Rollback(mark);
+            if(!moves.empty() && delta < best){
+                best = delta;
+                best_moves = moves;
+                tuned = NO_MACHINE;
+            }
+        }
+        //move the smallest VM off one of the most crowded PMs
+        for(unsigned i = 0; i < loaded.size() && i < MPC_CANDIDATES; i++){
+            MachineId_t source = loaded[loaded.size() - 1 - i];
+            VMId_t vm_id = surrogate.Smallest(source);
+            if(touched.count(source) > 0 || vm_id == NO_VM || surrogate.Tasks(source) <= Machine_GetInfoRef(source).num_cpus){
+                continue;
+            }
+            double move = 0.0;
+            MachineId_t dest = BestDestination(vm_id, unordered_map<MachineId_t, unsigned>(), move);
+            if(dest != NO_MACHINE && move < best){
+                best = move;
+                best_moves.assign(1, {vm_id, dest});
+                tuned = NO_MACHINE;
+            }
+        }
+        //step the P-state of a latency PM
+        for(MachineId_t machine_id : loaded){
+            const MachineInfo_t & machine_info = Machine_GetInfoRef(machine_id);
+            if(touched.count(machine_id) > 0 || placement.PoolOf(machine_id) != LATENCY_POOL || machine_info.s_state != S0){
+                continue;
+            }
+            for(int step : {-1, 1}){
+                int p_state = int(machine_info.p_state) + step;
+                if(p_state < int(P0) || p_state > int(P3)){
+                    continue;
+                }
+                double delta = surrogate.PStateDelta(machine_id, CPUPerformance_t(p_state));
+                if(delta < best){
+                    best = delta;
+                    best_moves.clear();
+                    tuned = machine_id;
+                    tuned_state = CPUPerformance_t(p_state);
+                }
+            }
+        }
+        if(best_moves.empty() && tuned == NO_MACHINE){
+            break;
+        }
+        for(const pair<VMId_t, MachineId_t> & move : best_moves){
+            VMId_t vm_id = move.first;
+            MachineId_t dest = move.second;
+            touched.insert(VM_GetInfoRef(vm_id).machine_id);
+            touched.insert(dest);
+            surrogate.Move(vm_id, dest);
+            migrating_VMs[vm_id] = VM_GetInfoRef(vm_id).machine_id;
+            reserved_mem[dest] += VM_GetMemoryFootprint(vm_id);
+            VM_Migrate(vm_id, dest);
+            migration_destinations.insert(dest);
+        }
+        if(tuned != NO_MACHINE){
+            touched.insert(tuned);
+            surrogate.SetPState(tuned, tuned_state);
+            Machine_SetCorePerformance(tuned, 0, tuned_state);
+        }
+    }
+}
+
+
 // This method should be called from SchedulerCheck()
 // SchedulerCheck is called periodically by the simulator to allow you to monitor, make decisions, adjustments, etc.
 // Unlike the other invocations of the scheduler, this one doesn't report any specific event
 // Recommendation: Take advantage of this function to do some monitoring and adjustments as necessary 
-// For the Greedy Algorithm, nothing is done.
+// For the Greedy Algorithm, the adjustments are serving tasks still waiting for a PM,
+// sizing the standby capacity, making room on the GPU hosts, promoting SLA2 tasks
+// that fall behind and consolidating.
 void Scheduler::PeriodicCheck(Time_t now) {
+    if(!wakeup_tasks.empty()){
+        ServeWaitingTasks();
+    }
+    if(now - last_standby >= STANDBY_PERIOD){
+        last_standby = now;
+        standby.Evaluate(now);
+    }
+    bool gpus_short = false;
+    for(unsigned cpu = 0; cpu < CPU_TYPES; cpu++){
+        gpus_short = gpus_short || gpu_shortfall[cpu] > 0;
+    }
+    if(gpus_short && now - last_gpu_review >= GPU_REVIEW_PERIOD){
+        last_gpu_review = now;
+        for(unsigned cpu = 0; cpu < CPU_TYPES; cpu++){
+            if(gpu_shortfall[cpu] > 0){
+                ReclaimGPUHosts(CPUType_t(cpu));
+                gpu_shortfall[cpu] = 0;
+            }
+        }
+    }
+    if(now - last_mpc >= MPC_PERIOD){
+        last_mpc = now;
+        Consolidate(now);
+    }
     // cout << "total tasks: " << total_tasks << " completed tasks: " << tasks_completed << " time: " << now << endl;
+    //promote the SLA2 tasks that the load model expects to miss their target
+    if(SLA_TIERS && now - last_review >= PRIORITY_REVIEW_PERIOD){
+        last_review = now;
+        for(auto it = mid_tasks.begin(); it != mid_tasks.end(); ){
+            if(load.FinishTime(*it, now) > GetTaskInfoRef(*it).target_completion){
+                SetTaskPriority(*it, HIGH_PRIORITY);
+                load.PriorityChanged(*it, HIGH_PRIORITY);
+                it = mid_tasks.erase(it);
+            } else{
+                it++;
+            }
+        }
+    }
 }
 
 /**
@@ -382,10 +860,11 @@ void Scheduler::Shutdown(Time_t time) {
     cout << "Simulation run finished in " << double(time)/1000000 << " seconds" << endl;
     SimOutput("SimulationComplete(): Simulation finished at time " + to_string(time), 4);
     cout << "total tasks: " << total_tasks << " completed tasks: " << tasks_completed << endl;
+    latency.Report();
 
     //shut down all VMs
     for(auto & vm: this->vms) {
-        VMInfo_t vm_info = VM_GetInfo(vm);
+        const VMInfo_t & vm_info = VM_GetInfoRef(vm);
         if(vm_info.active_tasks.size() == 0 && !IsMigrating(vm))
             VM_Shutdown(vm);
     }
@@ -405,35 +884,89 @@ void InitScheduler() {
     Scheduler.Init();
 }
 
-void HandleNewTask(Time_t time, TaskId_t task_id) {
-    SimOutput("HandleNewTask(): Received new task " + to_string(task_id) + " at time " + to_string(time), 4);
-    Scheduler.NewTask(time, task_id);
+void HandleNewTasks(Time_t time, const vector<TaskId_t> & task_ids) {
+    for(TaskId_t task_id : task_ids){
+        SimOutput("HandleNewTask(): Received new task " + to_string(task_id) + " at time " + to_string(time), 4);
+    }
+    Scheduler.NewTasks(time, task_ids);
 }
 
 void HandleTaskCompletion(Time_t time, TaskId_t task_id) {
     SimOutput("HandleTaskCompletion(): Task " + to_string(task_id) + " completed at time " + to_string(time), 4);
+    latency.TaskCompleted(task_id);
     Scheduler.TaskComplete(time, task_id);
 }
 
 
 
 /**
- * Runs when memory on a machine is overcommitted
+ * Helper function, the cost of moving a VM off an overcommitted PM. Its tasks
+ * stop for the whole migration, and the tighter their SLA the more that costs.
+ * @param vm_id the ID of the VM
+ */
+static double MigrationCost(VMId_t vm_id){
+    static const double sla_cost[NUM_SLAS] = {8.0, 4.0, 2.0, 1.0};
+    double cost = 1.0;
+    for(TaskId_t task_id : VM_GetInfoRef(vm_id).active_tasks){
+        cost += sla_cost[GetTaskInfoRef(task_id).required_sla];
+    }
+    return cost;
+}
+
+/**
+ * Helper function, finds the PM to move a VM to from an overcommitted PM. The
+ * placement index does not see the memory reserved for migrations still under
+ * way, so when its answer has been promised away the awake PMs are scanned.
+ * @param vm_id the ID of the VM
+ * @return the destination, NO_MACHINE if nothing has room for the VM
+ */
+static MachineId_t EvictionDestination(VMId_t vm_id){
+    const VMInfo_t & vm_info = VM_GetInfoRef(vm_id);
+    unsigned needed_mem = VM_GetMemoryFootprint(vm_id);
+    for(bool gpu : {false, true}){
+        MachineId_t dest = placement.FindRoom(vm_info.cpu, gpu, needed_mem, placement_policy);
+        if(dest != NO_MACHINE && CanMigrateVM(vm_id, dest)){
+            return dest;
+        }
+    }
+    for(MachineId_t machine_id : awake){
+        if(machine_id != vm_info.machine_id && CanMigrateVM(vm_id, machine_id)){
+            return machine_id;
+        }
+    }
+    return NO_MACHINE;
+}
+
+/**
+ * Runs when memory on a machine is overcommitted. The cheapest set of VMs that
+ * brings the PM back within its memory is migrated away right away, with the
+ * memory reserved on the destinations.
  * @param time the time of the warning
  * @param machine_id the ID of the machine whose memory is overcommitted
  */
 void MemoryWarning(Time_t time, MachineId_t machine_id) {
     SimOutput("MemoryWarning(): Overflow at machine " + to_string(machine_id) + " was detected at time " + to_string(time), 1);
-    //run the SLA violation routine on one of the tasks on the machine
-    
-    //try to find least utilized machine that is awake that can acommodate
-
-    // for(VMId_t vm : Scheduler.vms){
-    //     VMInfo_t vm_info = VM_GetInfo(vm);
-    //     if(vm_info.machine_id == machine_id && vm_info.active_tasks.size() > 0){
-    //         SLAWarning(time, vm_info.active_tasks[0]);
-    //     }
-    // }
+    const MachineInfo_t & machine_info = Machine_GetInfoRef(machine_id);
+    if(machine_info.memory_used <= machine_info.memory_size){
+        return;
+    }
+    vector<EvictionCandidate_t> candidates;
+    for(VMId_t vm_id : vms_on[machine_id]){
+        const VMInfo_t & vm_info = VM_GetInfoRef(vm_id);
+        if(!vm_info.active_tasks.empty() && !IsMigrating(vm_id)){
+            candidates.push_back({vm_id, VM_GetMemoryFootprint(vm_id), MigrationCost(vm_id)});
+        }
+    }
+    for(VMId_t vm_id : PlanEviction(candidates, machine_info.memory_used - machine_info.memory_size)){
+        MachineId_t dest = EvictionDestination(vm_id);
+        if(dest == NO_MACHINE){
+            continue;
+        }
+        migrating_VMs[vm_id] = VM_GetInfoRef(vm_id).machine_id;
+        reserved_mem[dest] += VM_GetMemoryFootprint(vm_id);
+        VM_Migrate(vm_id, dest);
+        migration_destinations.insert(dest);
+    }
 }
 
 
@@ -445,6 +978,15 @@ void MigrationDone(Time_t time, VMId_t vm_id) {
     Scheduler.MigrationComplete(time, vm_id);
 }
 
+void MachineDeltas(Time_t time, const vector<MachineDelta_t> & deltas) {
+    // The simulator reports the machines whose memory, tasks, VMs or S state changed
+    // during the last event, re-file them in the placement index
+    for(const MachineDelta_t & delta : deltas){
+        placement.Update(delta.machine_id);
+        rescue.Update(delta.machine_id);
+    }
+}
+
 void SchedulerCheck(Time_t time) {
     // This function is called periodically by the simulator, no specific event
     SimOutput("SchedulerCheck(): SchedulerCheck() called at " + to_string(time), 5);
@@ -455,74 +997,89 @@ void SimulationComplete(Time_t time) {
     Scheduler.Shutdown(time);
 }
 
+void SimulationForked(Time_t time, unsigned variant) {
+    // The rest of the run goes on in several variants, each but the original places
+    // batch work with another fit policy
+    placement_policy = FitPolicy_t((BEST_FIT + variant) % (WORST_FIT + 1));
+    SimOutput("SimulationForked(): Variant " + to_string(variant) + " at time " + to_string(time), 1);
+}
+
 
 
 /**
- * Runs whenever the SLA on the given task is violated. According to the
- * Greedy policy, we should migrate this task to another machine.
- * @param task_id the ID of the task whose SLA has been violated
+ * Helper function, rescues a task that the load model expects to miss its
+ * target. Raising the priority in place is preferred when that meets the
+ * target or beats moving, since a migration stops the task for
+ * MIGRATION_LATENCY. Otherwise its VM moves to the PM where it would finish
+ * first, which has to be a PM no other rescue picked in this round.
+ * @param task_id the task that is falling behind
+ * @param vm_id the VM of the task
+ * @param now the current time
+ * @param destinations the PMs picked by this round of rescues so far
  */
-void SLAWarning(Time_t time, TaskId_t task_id) {
-    //sort all PMs in order of utilization
-
-    std::sort(Scheduler.machines.begin(), Scheduler.machines.end(), MachineUtilComparator());
-
-    MachineId_t dest = 0XDEADBEEF;
-    bool found = false;
-    //find machine and VM that can accommodate the task
-    //note: some of these PMs can be sleeping or shut down
-    for(unsigned i = 0; i < Scheduler.machines.size(); i++){
-        MachineId_t potential_dest = Scheduler.machines[i];
-        MachineInfo_t dest_info = Machine_GetInfo(potential_dest);
-        if(CPUCompatible(potential_dest, task_id) 
-                && TaskMemoryFits(potential_dest, task_id)){
-            dest = potential_dest;
-            found = true;
-            break;
+static void RescueTask(TaskId_t task_id, VMId_t vm_id, Time_t now, unordered_set<MachineId_t> & destinations){
+    const TaskInfo_t & task_info = GetTaskInfoRef(task_id);
+    const VMInfo_t & vm_info = VM_GetInfoRef(vm_id);
+    Time_t in_place = load.PredictFinish(task_id, vm_info.machine_id, HIGH_PRIORITY, now);
+    Time_t moved = NEVER;
+    unsigned needed_mem = VM_GetMemoryFootprint(vm_id);
+    MachineId_t dest = rescue.Fastest(task_id, needed_mem, Machine_GetInfoRef(vm_info.machine_id).gpus, vm_info.machine_id);
+    if(dest != NO_MACHINE && destinations.count(dest) == 0 && CanMigrateVM(vm_id, dest)){
+        double mips = load.HostMIPS(dest, task_info.priority, task_info.gpu_capable);
+        moved = mips > 0.0 ? now + MIGRATION_LATENCY + Time_t(double(task_info.remaining_instructions) / mips) : NEVER;
+    }
+    if(in_place <= task_info.target_completion || in_place <= moved){
+        if(task_info.priority != HIGH_PRIORITY){
+            SetTaskPriority(task_id, HIGH_PRIORITY);
+            load.PriorityChanged(task_id, HIGH_PRIORITY);
+            mid_tasks.erase(task_id);
         }
+        return;
     }
+    destinations.insert(dest);
+    migrating_VMs[vm_id] = VM_GetInfoRef(vm_id).machine_id;
+    reserved_mem[dest] += needed_mem;
+    VM_Migrate(vm_id, dest);
+    migration_destinations.insert(dest);
+}
 
-    //destination machine found. migrate the task there.
-    if(found){
-        MachineInfo_t dest_info = Machine_GetInfo(dest);
-        VMId_t vm_to_migrate = task_to_vm[task_id];
-
-
-        if(IsAwake(dest) && !changing_state[dest]){
-            //destination machine active, can migrate immediately
-            //update migration mapping
-            if(CanMigrateVM(vm_to_migrate, dest)){
-                VMInfo_t src_vm_info = VM_GetInfo(vm_to_migrate);
-                migrating_VMs.insert(vm_to_migrate);
-                // cout << "[sla warning] migrating VM " << vm_to_migrate << " to machine " << dest << endl;
-                unsigned needed_mem = VM_MEMORY_OVERHEAD;
-                for(TaskId_t task : src_vm_info.active_tasks){
-                    needed_mem += GetTaskMemory(task);
-                }
-                // cout << "adding to reserved mem " << needed_mem << endl;
-                reserved_mem[dest] += needed_mem;
-                VM_Migrate(vm_to_migrate, dest);
-                migration_destinations.insert(dest);
-            }
-        } else{
-            //no awake machines, try to put one on standby
-            //and put it in queue
-            //assigning to a machine is handled when a machine wakes up
-            //NOTE: some of these could have already finished by the time
-            //the machine wakes up. What to do in that case?
-            wakeup_migrations.push_back(vm_to_migrate);
-            if(!changing_state[dest]){
-                // cout << "[sla warning] request to turn on machine " << dest << endl;
-                Machine_SetState(dest, S0);
-                changing_state[dest] = true;
-                // cout << "changing[" << dest << "] true" << endl;
+/**
+ * Runs whenever a task finishes after its SLA target. The PM it ran on is
+ * falling behind, so the tasks still on it that the load model expects to miss
+ * their own targets are rescued: the PM goes to P0 first, then each task is
+ * rescued in place or moved, whichever finishes it sooner. A PM is looked at
+ * no more than once every RESCUE_PERIOD, so a burst of warnings from one PM
+ * costs one pass over its VMs.
+ * @param task_id the ID of the task whose SLA has been violated
+ */
+void SLAWarning(Time_t time, TaskId_t task_id) {
+    auto task_vm = task_to_vm.find(task_id);
+    if(task_vm == task_to_vm.end()){
+        return;
+    }
+    MachineId_t machine_id = VM_GetInfoRef(task_vm->second).machine_id;
+    const MachineInfo_t & machine_info = Machine_GetInfoRef(machine_id);
+    auto last = last_rescue.find(machine_id);
+    if(machine_info.s_state != S0 || (last != last_rescue.end() && time - last->second < RESCUE_PERIOD)){
+        return;
+    }
+    last_rescue[machine_id] = time;
+    if(machine_info.p_state != P0){
+        Machine_SetCorePerformance(machine_id, 0, P0);
+    }
+    unordered_set<MachineId_t> destinations;
+    for(VMId_t vm_id : vms_on[machine_id]){
+        const VMInfo_t & vm_info = VM_GetInfoRef(vm_id);
+        if(IsMigrating(vm_id)){
+            continue;
+        }
+        for(TaskId_t vm_task : vm_info.active_tasks){
+            const TaskInfo_t & task_info = GetTaskInfoRef(vm_task);
+            if(task_info.required_sla != SLA3 && load.FinishTime(vm_task, time) > task_info.target_completion){
+                RescueTask(vm_task, vm_id, time, destinations);
+                break;
             }
         }
-    } else{
-        //failure case: no destination machine w/ compatible CPUs and enough
-        //memory.
-        throw std::runtime_error("Unable to find machine to migrate task " 
-                    + to_string(task_id) + " to after SLA Violation");
     }
 }
 
@@ -535,7 +1092,7 @@ void SLAWarning(Time_t time, TaskId_t task_id) {
  * @param machine_id the ID of the machine whose state has changed
  */
 void StateChangeComplete(Time_t time, MachineId_t machine_id) {
-    MachineInfo_t machine_info = Machine_GetInfo(machine_id);
+    const MachineInfo_t & machine_info = Machine_GetInfoRef(machine_id);
     changing_state[machine_id] = false;
     // cout << "changing_state[" << machine_id << "] false" << endl;
     //just updated to awake state
@@ -548,13 +1105,8 @@ void StateChangeComplete(Time_t time, MachineId_t machine_id) {
         vector<TaskId_t>::iterator wakeup_task_it = wakeup_tasks.begin();
         while(wakeup_task_it != wakeup_tasks.end()){
             TaskId_t task_id = *wakeup_task_it;
-            TaskInfo_t task_info = GetTaskInfo(task_id);
             if(CPUCompatible(machine_id, task_id) && TaskMemoryFits(machine_id, task_id)){
-                VMId_t new_vm = VM_Create(task_info.required_vm, machine_info.cpu);
-                Scheduler.vms.push_back(new_vm);
-                VM_Attach(new_vm, machine_id);
-                VM_AddTask(new_vm, task_id, task_info.priority);
-                task_to_vm[task_id] = new_vm;
+                StartTask(task_id, machine_id);
 
                 //added task, remove from queue
                 wakeup_task_it = wakeup_tasks.erase(wakeup_task_it);
@@ -562,38 +1114,15 @@ void StateChangeComplete(Time_t time, MachineId_t machine_id) {
                 wakeup_task_it++;
             }
         }
-
-        //migrate all VMs that needed to be migrated
-        //NOTE: some of these could have shut down between when they were added
-        //      to the queue and the present
-        vector<TaskId_t>::iterator wakeup_vm_it = wakeup_migrations.begin();
-        while(wakeup_vm_it != wakeup_migrations.end()){
-            VMId_t vm_id = *wakeup_vm_it;
-            VMInfo_t vm_info = VM_GetInfo(vm_id);
-            //see if we have enough memory to migrate there
-            if(CanMigrateVM(vm_id, machine_id)){
-                // cout << "[state change fin] migrating VM " << vm_id << " to machine " << machine_id << endl;
-                unsigned needed_mem = VM_MEMORY_OVERHEAD;
-                for(TaskId_t task : vm_info.active_tasks){
-                    needed_mem += GetTaskMemory(task);
-                }
-                // cout << "adding to reserved mem " << needed_mem << endl;
-                reserved_mem[machine_id] += needed_mem;
-                VM_Migrate(vm_id, machine_id);
-                migration_destinations.insert(machine_id);
-                //migrated VM, remove from queue
-                wakeup_vm_it = wakeup_migrations.erase(wakeup_vm_it);
-            } else{
-                wakeup_vm_it++;
-            }
-        }
     } else{
         //this can happen. 
         if(awake.count(machine_id) > 0){
             awake.erase(awake.find(machine_id));
+            powered[machine_info.cpu]--;
         }
         // cout << "machine " << machine_id << " fully down" << endl;
     }
+    ServeWaitingTasks();
 }
 
   
@@ -601,6 +1130,30 @@ void StateChangeComplete(Time_t time, MachineId_t machine_id) {
 // BELOW THIS COMMENT ARE ALL HELPER FUNCTIONS THAT PRINT STUFF
 
 
+/**
+ * Helper function to convert SLA requirements into priorities for 
+ * scheduling. This function should change if needed based on the scheduler.
+ * @param sla the SLA we want to convert
+ * @return the equivalent task priority.
+ */
+static Priority_t sla_to_priority(SLAType_t sla){
+    switch(sla){
+        case SLA0:
+            return HIGH_PRIORITY;
+        case SLA1:
+            return HIGH_PRIORITY;
+        case SLA2:
+            return MID_PRIORITY;
+        case SLA3:
+            return LOW_PRIORITY;
+        default:
+            break;
+    }
+    return MID_PRIORITY;
+}
+
+
+
 /**
  * Helper function to print all information about a given task
  * @param task the ID of the task we want info about
@@ -609,7 +1162,7 @@ void StateChangeComplete(Time_t time, MachineId_t machine_id) {
  */
 static void print_task_info(TaskId_t task)
 {
-    TaskInfo_t inf = GetTaskInfo(task);
+    const TaskInfo_t & inf = GetTaskInfoRef(task);
     printf("------------TASK INFO FOR ID [%u]-------------\n", task);
     //completion status
     printf("TASK %s\n", inf.completed ? "COMPLETED" : "UNFINISHED");
@@ -641,7 +1194,7 @@ static void print_task_info(TaskId_t task)
  */
 static void print_machine_info(MachineId_t machine)
 {
-    MachineInfo_t inf = Machine_GetInfo(machine);
+    const MachineInfo_t & inf = Machine_GetInfoRef(machine);
     printf("------------MACHINE INFO FOR ID [%u]------------\n", machine);
     //general machine info
     printf("S-State: %s\n", sstate_tostring(inf.s_state).c_str());
@@ -798,7 +1351,7 @@ static string pstate_tostring(CPUPerformance_t state)
  */
 static void print_vm_info (VMId_t vm)
 {
-    VMInfo_t inf = VM_GetInfo(vm);
+    const VMInfo_t & inf = VM_GetInfoRef(vm);
     printf ("------------VM Info for ID [%u]------------\n", vm);
     //print all active tasks
     const int N = inf.active_tasks.size();
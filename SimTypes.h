@@ -21,6 +21,8 @@ typedef unsigned MachineId_t;
 typedef unsigned VMId_t;
 typedef unsigned TaskId_t;
 
+#define NO_MACHINE MachineId_t(-1)      // No machine, e.g. when none fits
+
 typedef enum {
     P0,         // CPU at normal frequency
     P1,         // CPU at 3/4 frequency, 0.8 voltage
@@ -43,6 +45,7 @@ typedef enum {
     RISCV,
     X86
 } CPUType_t;
+#define CPU_TYPES 4
 
 typedef enum {
     S0,         // Machine is up. CPU's are at state C0 if running a task or C1
@@ -85,6 +88,23 @@ typedef enum {
     AIX
 } VMType_t;
 #define VM_MEMORY_OVERHEAD  8 
+#define NORMAL_SLOWDOWN     100         // Percent slowdown applied to the MIPS rating, depending on memory overcommitment
+#define SWAPPING_SLOWDOWN   200         // Memory in use above the memory size
+#define THRASHING_SLOWDOWN  400         // Memory in use above twice the memory size
+#define GPU_SPEEDUP         20          // Speedup of a GPU capable task on a machine with GPUs
+#define MIGRATION_LATENCY   30000000    // Time to move a virtual machine between two machines, its tasks stop meanwhile
+
+typedef struct {
+    unsigned num_cpus;                      // Number of CPU's on every machine of the class
+    CPUType_t cpu;
+    unsigned memory_size;
+    bool gpus;
+    vector<unsigned> performance;           // The MIPS ratings for the CPUs at different p-state
+    vector<unsigned> c_states;              // Power consumption under different C states
+    vector<unsigned> p_states;              // Power consumption for cores at different P states. Valid only when C-state is C0.
+    vector<unsigned> s_states;              // Machine power consumption under different S states
+    unsigned machine_class;                 // The index of the class, classes are numbered in the order their first machine was added
+} MachineClassInfo_t;
 
 typedef struct {
     unsigned num_cpus;                      // Number of CPU's on the machine
@@ -95,15 +115,30 @@ typedef struct {
     unsigned active_vms;                    // Number of virtual machines that are attached to this machine
     bool gpus;                              // True if the processors are equipped with a GPU, false otherwise
     uint64_t energy_consumed;               // How much energy has been consumed so far
-    vector<unsigned> performance;           // The MIPS ratings for the CPUs at different p-state
-    vector<unsigned> c_states;              // Power consumption under different C states
-    vector<unsigned> p_states;              // Power consumption for cores at different P states. Valid only when C-state is C0.
-    vector<unsigned> s_states;              // Machine power consumption under different S states
+    unsigned machine_class;                 // Where the power and MIPS tables are, see Machine_GetClassInfo()
     MachineState_t s_state;                 // The current S state of the machine
     CPUPerformance_t p_state;               // The current P state of the CPUs (all CPUs are set to the same P state to simplify scheduling
     MachineId_t machine_id;                 // The identifier of the machine
 } MachineInfo_t;
 
+typedef struct {
+    MachineId_t machine_id;
+    int memory_used;                        // Change in memory in use since the machine was last reported
+    int active_tasks;                       // Change in the number of tasks assigned to the machine
+    int active_vms;                         // Change in the number of virtual machines attached to the machine
+    MachineState_t previous_state;          // S state when the machine was last reported
+    MachineState_t s_state;                 // The current S state of the machine
+} MachineDelta_t;
+
+typedef struct {
+    Time_t start;                           // The window is [start, end)
+    Time_t end;
+    unsigned completed[NUM_SLAS];           // Tasks that completed within the window
+    unsigned violations[NUM_SLAS];          // How many of those missed their target
+    double energy;                          // Energy the cluster consumed within the window, in KW-Hour
+    double awake_hosts;                     // Machines in S0, averaged over the window
+} WindowReport_t;
+
 typedef struct {
     bool completed;
 
@@ -120,6 +155,7 @@ typedef struct {
     unsigned required_memory;
     SLAType_t required_sla;
     VMType_t required_vm;
+    TaskClass_t task_class;
 
     TaskId_t task_id;
 } TaskInfo_t;
@@ -0,0 +1,617 @@
+//
+//  Simulator.cpp
+//  CloudSim
+//
+//  Created by ELMOOTAZBELLAH ELNOZAHY on 10/20/24.
+//
+
+#include <algorithm>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "Interfaces.h"
+#include "Internal_Interfaces.h"
+
+// Events are plain records kept in a pool and recycled through a free list, so
+// scheduling an event never touches the allocator once the pool has warmed up.
+// The pending set is either a binary heap of (time, slot) pairs (the default) or
+// a calendar queue of per-bucket linked lists. The set is chosen at startup by
+// setting CLOUDSIM_EVENT_QUEUE to "heap" or "calendar" in the environment.
+//
+// Task arrivals are all known before the simulation starts, so they stay out of the
+// pending set. They are sorted once by time, and a single TASK_ARRIVAL event walks the
+// list, handing the scheduler every task that arrives at the same time in one batch.
+// Setting CLOUDSIM_ARRIVAL_WINDOW to a number of microseconds widens a batch to all the
+// tasks arriving within that long of its first task; the batch is then delivered at the
+// arrival time of its last task.
+//
+// A run can be forked for what-if evaluation: with CLOUDSIM_FORK_AT set to a time in
+// microseconds, the process forks CLOUDSIM_FORKS copies of itself (1 by default) just
+// before the first event at or after that time. The copies share everything simulated
+// so far, copy-on-write, and carry on from there as variants 1 to n, with the original
+// run as variant 0. Each is told its variant through SimulationForked(), where it can
+// switch policies or parameters for the rest of the run. Variant n writes its output to
+// CLOUDSIM_FORK_OUTPUT.n ("variant.n" by default), and the original run waits for all
+// of them before it exits.
+//
+// The SLA, energy and awake machine figures of the last CLOUDSIM_WINDOW microseconds
+// (2 s by default) are kept up as the run goes, see Metrics.cpp.
+//
+// Setting CLOUDSIM_TELEMETRY to a file name records a time series of every machine and
+// of the SLA counters at each timer tick, see Telemetry.cpp.
+//
+// Setting CLOUDSIM_TRACE to a file name writes a timeline of task lifetimes, migrations,
+// S-state and P-state changes and SLA warnings that chrome://tracing and Perfetto open,
+// see Trace.cpp.
+
+typedef enum {
+    TASK_ARRIVAL,
+    TASK_COMPLETION,
+    MIGRATION_COMPLETION,
+    TIMER
+} EventType_t;
+
+typedef unsigned EventSlot_t;
+#define NO_SLOT EventSlot_t(-1)
+
+typedef struct {
+    Time_t      time;
+    EventType_t type;
+    union {
+        MachineId_t machine_id; // TASK_COMPLETION
+        VMId_t vm_id;           // MIGRATION_COMPLETION
+    };
+    unsigned    core_id;        // TASK_COMPLETION
+    EventSlot_t next;           // Calendar bucket links, next is reused as the free list link
+    EventSlot_t prev;
+} Event_t;
+
+class EventHeap {
+public:
+    EventHeap(vector<Event_t> & pool) : pool(pool) {}
+    bool            Empty() const       { return heap.empty(); }
+    size_t          Size() const        { return heap.size(); }
+    void            Push(EventSlot_t slot);
+    EventSlot_t     Pop();
+private:
+    typedef struct {
+        Time_t      time;
+        EventSlot_t slot;
+    } HeapEntry_t;
+
+    void            SiftUp(unsigned hole, HeapEntry_t entry);
+
+    vector<Event_t> & pool;
+    vector<HeapEntry_t> heap;
+};
+
+// The sift routines follow std::push_heap/std::pop_heap step for step. Events that
+// share a timestamp therefore come out in the same order as they did when the queue
+// was a std::priority_queue ordered on the event time alone, which keeps every
+// scheduler callback, and hence the simulation results, unchanged.
+void EventHeap::SiftUp(unsigned hole, HeapEntry_t entry) {
+    while(hole > 0) {
+        unsigned parent = (hole - 1) / 2;
+        if(heap[parent].time <= entry.time) {
+            break;
+        }
+        heap[hole] = heap[parent];
+        hole = parent;
+    }
+    heap[hole] = entry;
+}
+
+void EventHeap::Push(EventSlot_t slot) {
+    heap.push_back({pool[slot].time, slot});
+    SiftUp(unsigned(heap.size() - 1), heap.back());
+}
+
+EventSlot_t EventHeap::Pop() {
+    HeapEntry_t top = heap.front();
+    HeapEntry_t last = heap.back();
+    heap.pop_back();
+    unsigned len = unsigned(heap.size());
+    if(len > 0) {
+        // Move the hole at the root down to a leaf, always following the earlier child
+        // (the right one on ties), then bubble the displaced last entry back up from there
+        unsigned hole = 0;
+        unsigned child = 0;
+        while(child < (len - 1) / 2) {
+            child = 2 * (child + 1);
+            if(heap[child].time > heap[child - 1].time) {
+                child--;
+            }
+            heap[hole] = heap[child];
+            hole = child;
+        }
+        if((len & 1) == 0 && child == (len - 2) / 2) {
+            child = 2 * (child + 1);
+            heap[hole] = heap[child - 1];
+            hole = child - 1;
+        }
+        SiftUp(hole, last);
+    }
+    return top.slot;
+}
+
+// Calendar queue (R. Brown, CACM 1988). Time is cut into buckets of 2^shift
+// microseconds that wrap around a "year" of buckets. Each bucket is a list kept in
+// time order, with events of equal time in the order they were scheduled. Dequeue
+// scans forward from the bucket holding the last event taken, so inserting and
+// removing an event near "now" costs O(1) amortized. The calendar is rebuilt with a
+// fresh bucket count and width whenever the population doubles or halves.
+#define CALENDAR_MIN_BUCKETS 64
+#define CALENDAR_SAMPLE 25
+
+class CalendarQueue {
+public:
+    CalendarQueue(vector<Event_t> & pool) : pool(pool), count(0), shift(10), current(0), top(0) { Resize(CALENDAR_MIN_BUCKETS); }
+    bool            Empty() const       { return count == 0; }
+    size_t          Size() const        { return count; }
+    void            Push(EventSlot_t slot);
+    EventSlot_t     Pop();
+private:
+    typedef struct {
+        EventSlot_t head;
+        EventSlot_t tail;
+    } Bucket_t;
+
+    unsigned        BucketOf(Time_t time) const { return unsigned(time >> shift) & mask; }
+    void            Link(EventSlot_t slot);
+    void            Resize(unsigned buckets);
+    void            SetCurrent(Time_t time);
+    EventSlot_t     Unlink(unsigned bucket);
+
+    vector<Event_t> & pool;
+    vector<Bucket_t> buckets;
+    size_t          count;
+    unsigned        mask;
+    unsigned        shift;      // Bucket width is 2^shift microseconds
+    unsigned        current;    // Bucket the next dequeue starts scanning from
+    Time_t          top;        // End of the current bucket's window in this year
+};
+
+void CalendarQueue::SetCurrent(Time_t time) {
+    current = BucketOf(time);
+    top = ((time >> shift) + 1) << shift;
+}
+
+void CalendarQueue::Link(EventSlot_t slot) {
+    Event_t & event = pool[slot];
+    Bucket_t & bucket = buckets[BucketOf(event.time)];
+    // Walk back from the tail: new events usually sort last in their bucket
+    EventSlot_t after = bucket.tail;
+    while(after != NO_SLOT && pool[after].time > event.time) {
+        after = pool[after].prev;
+    }
+    event.prev = after;
+    if(after == NO_SLOT) {
+        event.next = bucket.head;
+        bucket.head = slot;
+    }
+    else {
+        event.next = pool[after].next;
+        pool[after].next = slot;
+    }
+    if(event.next == NO_SLOT) {
+        bucket.tail = slot;
+    }
+    else {
+        pool[event.next].prev = slot;
+    }
+}
+
+EventSlot_t CalendarQueue::Unlink(unsigned bucket) {
+    EventSlot_t slot = buckets[bucket].head;
+    buckets[bucket].head = pool[slot].next;
+    if(buckets[bucket].head == NO_SLOT) {
+        buckets[bucket].tail = NO_SLOT;
+    }
+    else {
+        pool[buckets[bucket].head].prev = NO_SLOT;
+    }
+    return slot;
+}
+
+void CalendarQueue::Resize(unsigned size) {
+    // Pull every pending event out in calendar order, which preserves the order of equal times
+    vector<EventSlot_t> pending;
+    pending.reserve(count);
+    for(Bucket_t & bucket : buckets) {
+        for(EventSlot_t slot = bucket.head; slot != NO_SLOT; slot = pool[slot].next) {
+            pending.push_back(slot);
+        }
+    }
+    // Size the buckets to about three times the average gap between the earliest events
+    if(pending.size() > 1) {
+        vector<Time_t> sample;
+        sample.reserve(pending.size());
+        for(EventSlot_t slot : pending) {
+            sample.push_back(pool[slot].time);
+        }
+        size_t n = min(sample.size(), size_t(CALENDAR_SAMPLE));
+        partial_sort(sample.begin(), sample.begin() + n, sample.end());
+        size_t distinct = unique(sample.begin(), sample.begin() + n) - sample.begin();
+        // A burst of identical timestamps says nothing about the spacing, keep the old width then
+        if(distinct > 1) {
+            Time_t width = 3 * ((sample[distinct - 1] - sample[0]) / (distinct - 1));
+            shift = 0;
+            while((Time_t(1) << shift) < width) {
+                shift++;
+            }
+        }
+    }
+    buckets.assign(size, {NO_SLOT, NO_SLOT});
+    mask = size - 1;
+    Time_t earliest = Time_t(-1);
+    for(EventSlot_t slot : pending) {
+        Link(slot);
+        earliest = min(earliest, pool[slot].time);
+    }
+    if(!pending.empty()) {
+        SetCurrent(earliest);
+    }
+}
+
+void CalendarQueue::Push(EventSlot_t slot) {
+    Time_t time = pool[slot].time;
+    if(count == 0 || time < top - (Time_t(1) << shift)) {
+        // Either the calendar is empty or the event lands before the current window
+        SetCurrent(time);
+    }
+    Link(slot);
+    if(++count > 2 * buckets.size()) {
+        Resize(unsigned(2 * buckets.size()));
+    }
+}
+
+EventSlot_t CalendarQueue::Pop() {
+    EventSlot_t slot = NO_SLOT;
+    for(unsigned i = 0; i < buckets.size(); i++) {
+        EventSlot_t head = buckets[current].head;
+        if(head != NO_SLOT && pool[head].time < top) {
+            slot = Unlink(current);
+            break;
+        }
+        current = (current + 1) & mask;
+        top += Time_t(1) << shift;
+    }
+    if(slot == NO_SLOT) {
+        // Nothing due within a whole year: jump straight to the earliest event
+        Time_t earliest = Time_t(-1);
+        for(Bucket_t & bucket : buckets) {
+            if(bucket.head != NO_SLOT && pool[bucket.head].time < earliest) {
+                earliest = pool[bucket.head].time;
+            }
+        }
+        SetCurrent(earliest);
+        slot = Unlink(current);
+    }
+    if(--count < buckets.size() / 2 && buckets.size() > CALENDAR_MIN_BUCKETS) {
+        Resize(unsigned(buckets.size() / 2));
+    }
+    return slot;
+}
+
+class EventQueue {
+public:
+    EventQueue();
+    bool            Empty() const       { return calendar ? calendar_queue.Empty() : heap.Empty(); }
+    size_t          Size() const        { return calendar ? calendar_queue.Size() : heap.Size(); }
+    Event_t &       operator[](EventSlot_t slot)    { return pool[slot]; }
+    EventSlot_t     Allocate(EventType_t type);
+    void            Push(Time_t time, EventSlot_t slot);
+    EventSlot_t     Pop();
+    void            Release(EventSlot_t slot);
+private:
+    void            SelectQueue();
+
+    vector<Event_t> pool;
+    EventSlot_t     free_list;
+    bool            calendar;
+    EventHeap       heap;
+    CalendarQueue   calendar_queue;
+};
+
+EventQueue::EventQueue() : free_list(NO_SLOT), calendar(false), heap(pool), calendar_queue(pool) {}
+
+// Called when the first event is scheduled rather than from the constructor, so that a
+// bad setting surfaces as a regular simulator exception
+void EventQueue::SelectQueue() {
+    const char * choice = getenv("CLOUDSIM_EVENT_QUEUE");
+    if(choice != NULL) {
+        if(strcmp(choice, "calendar") == 0) {
+            calendar = true;
+        }
+        else if(strcmp(choice, "heap") != 0) {
+            ThrowException("EventQueue(): Unknown event queue ", choice);
+        }
+    }
+}
+
+EventSlot_t EventQueue::Allocate(EventType_t type) {
+    EventSlot_t slot;
+    if(free_list != NO_SLOT) {
+        slot = free_list;
+        free_list = pool[slot].next;
+    }
+    else {
+        if(pool.empty()) {
+            SelectQueue();
+        }
+        slot = EventSlot_t(pool.size());
+        pool.emplace_back();
+    }
+    pool[slot].type = type;
+    return slot;
+}
+
+void EventQueue::Release(EventSlot_t slot) {
+    pool[slot].next = free_list;
+    free_list = slot;
+}
+
+void EventQueue::Push(Time_t time, EventSlot_t slot) {
+    pool[slot].time = time;
+    if(calendar) {
+        calendar_queue.Push(slot);
+    }
+    else {
+        heap.Push(slot);
+    }
+}
+
+EventSlot_t EventQueue::Pop() {
+    return calendar ? calendar_queue.Pop() : heap.Pop();
+}
+
+typedef struct {
+    Time_t      time;
+    TaskId_t    task_id;
+} Arrival_t;
+
+class Simulator {
+public:
+    Simulator() : now(0), started(false), next_arrival(0), arrival_window(0), fork_at(UINT64_MAX), forks(1), fork_output("variant") {}
+    void            AddArrival(Time_t time, TaskId_t task_id);
+    void            AddEvent(Time_t time, EventSlot_t slot)     { events.Push(time, slot); }
+    EventSlot_t     NewEvent(EventType_t type)                  { return events.Allocate(type); }
+    Event_t &       GetEvent(EventSlot_t slot)                  { return events[slot]; }
+    Time_t          Now()                                       { return now; }
+    void            Simulate();
+private:
+    size_t          BatchEnd();
+    void            DeliverArrivals();
+    void            Execute(const Event_t & event);
+    void            Fork();
+    void            PrepareArrivals();
+    void            PrepareFork();
+    void            PrepareWorkers();
+    void            WaitForVariants();
+    void            ScheduleArrivals();
+
+    EventQueue      events;
+    Time_t          now;
+    bool            started;
+    vector<Arrival_t> arrivals;         // Sorted by time once the simulation starts
+    size_t          next_arrival;       // First arrival not handed to the scheduler yet
+    Time_t          arrival_window;
+    vector<TaskId_t> batch;
+    Time_t          fork_at;
+    unsigned        forks;
+    string          fork_output;
+    vector<pid_t>   variants;           // Forked off this process, left to wait for
+};
+
+static Simulator Simulator;
+
+void Simulator::AddArrival(Time_t time, TaskId_t task_id) {
+    if(started) {
+        ThrowException("ScheduleNewTask(): Tasks have to be added before the simulation starts, task ", task_id);
+    }
+    arrivals.push_back({time, task_id});
+}
+
+#define MAX_THREADS 256             // CLOUDSIM_THREADS beyond this is taken for a mistake
+
+// Settings are plain decimal numbers; strtoull() alone would also take a sign or
+// leading blanks, and turn "-1" into a huge value
+static uint64_t ReadSetting(const char * name, const char * value) {
+    char * end;
+    uint64_t setting = strtoull(value, &end, 10);
+    if(!isdigit((unsigned char)(*value)) || *end != '\0') {
+        ThrowException(string("Simulate(): Invalid ") + name + " ", value);
+    }
+    return setting;
+}
+
+void Simulator::PrepareArrivals() {
+    const char * window = getenv("CLOUDSIM_ARRIVAL_WINDOW");
+    if(window != NULL) {
+        arrival_window = ReadSetting("arrival window", window);
+    }
+    // Tasks that arrive together go to the scheduler latest added first, which is how the
+    // event heap used to order most of their arrival events
+    sort(arrivals.begin(), arrivals.end(), [](const Arrival_t & a, const Arrival_t & b) { return a.time < b.time || (a.time == b.time && a.task_id > b.task_id); });
+    started = true;
+    ScheduleArrivals();
+}
+
+// One past the last arrival of the batch that starts at next_arrival
+size_t Simulator::BatchEnd() {
+    Time_t last = arrivals[next_arrival].time + arrival_window;
+    size_t end = next_arrival + 1;
+    while(end < arrivals.size() && arrivals[end].time <= last) {
+        end++;
+    }
+    return end;
+}
+
+void Simulator::ScheduleArrivals() {
+    if(next_arrival < arrivals.size()) {
+        AddEvent(arrivals[BatchEnd() - 1].time, NewEvent(TASK_ARRIVAL));
+    }
+}
+
+void Simulator::DeliverArrivals() {
+    size_t end = BatchEnd();
+    batch.clear();
+    for(size_t i = next_arrival; i < end; i++) {
+        batch.push_back(arrivals[i].task_id);
+    }
+    next_arrival = end;
+    ScheduleArrivals();
+    HandleNewTasks(now, batch);
+}
+
+void Simulator::PrepareWorkers() {
+    const char * threads = getenv("CLOUDSIM_THREADS");
+    if(threads == NULL) {
+        return;
+    }
+    uint64_t count = ReadSetting("thread count", threads);
+    if(count < 1 || count > MAX_THREADS) {
+        ThrowException("Simulate(): Invalid thread count ", threads);
+    }
+    Machine_StartWorkers(unsigned(count - 1));
+}
+
+void Simulator::PrepareFork() {
+    const char * at = getenv("CLOUDSIM_FORK_AT");
+    if(at == NULL) {
+        return;
+    }
+    fork_at = ReadSetting("fork time", at);
+    const char * count = getenv("CLOUDSIM_FORKS");
+    if(count != NULL) {
+        forks = unsigned(ReadSetting("fork count", count));
+    }
+    const char * output = getenv("CLOUDSIM_FORK_OUTPUT");
+    if(output != NULL) {
+        fork_output = output;
+    }
+}
+
+void Simulator::Fork() {
+    fork_at = UINT64_MAX;
+    // Only the calling thread lives on in a child, and buffered output would be written twice
+    unsigned workers = Machine_StopWorkers();
+    Telemetry_Suspend();
+    Trace_Suspend();
+    cout.flush();
+    fflush(stdout);
+    unsigned variant = 0;
+    for(unsigned i = 1; i <= forks; i++) {
+        pid_t pid = fork();
+        if(pid < 0) {
+            ThrowException("Simulate(): Could not fork variant ", i);
+        }
+        if(pid == 0) {
+            variant = i;
+            variants.clear();
+            string name = fork_output + "." + to_string(i);
+            if(freopen(name.c_str(), "w", stdout) == NULL) {
+                ThrowException("Simulate(): Could not open variant output ", name);
+            }
+            break;
+        }
+        variants.push_back(pid);
+    }
+    Machine_StartWorkers(workers);
+    Telemetry_Resume(variant);
+    Trace_Resume(variant);
+    SimOutput("Simulate(): Running as variant " + to_string(variant) + " from time " + to_string(now), 1);
+    SimulationForked(now, variant);
+}
+
+void Simulator::WaitForVariants() {
+    for(unsigned i = 0; i < variants.size(); i++) {
+        int status;
+        if(waitpid(variants[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            SimOutput("Simulate(): Variant " + to_string(i + 1) + " did not finish cleanly", 0);
+        }
+    }
+    variants.clear();
+}
+
+void Simulator::Execute(const Event_t & event) {
+    switch(event.type) {
+        case TASK_ARRIVAL:
+            DeliverArrivals();
+            break;
+        case TASK_COMPLETION:
+            Machine_CompleteTask(event.machine_id, event.core_id);
+            break;
+        case MIGRATION_COMPLETION:
+            VM_MigrationCompleted(event.vm_id);
+            break;
+        case TIMER:
+            Machine_HandleTimer(event.time);
+            break;
+    }
+}
+
+void Simulator::Simulate() {
+    SimOutput("Simulate(): There are " + to_string(events.Size() + arrivals.size()) + " events in the simulator", 1);
+    PrepareArrivals();
+    PrepareFork();
+    PrepareWorkers();
+    Metrics_Start();
+    Telemetry_Start();
+    Trace_Start();
+    while(!events.Empty()) {
+        EventSlot_t slot = events.Pop();
+        // Copy the record out and recycle the slot first: the handler is free to schedule new events
+        Event_t event = events[slot];
+        events.Release(slot);
+        now = event.time;
+        if(now >= fork_at) {
+            Fork();
+        }
+        Execute(event);
+        Machine_ReportDeltas(now);
+    }
+    Telemetry_Stop();
+    Trace_Stop();
+    SimulationComplete(now);
+    WaitForVariants();
+}
+
+void StartSimulation() {
+    Simulator.Simulate();
+}
+
+void ScheduleMigrationCompletion(Time_t time, VMId_t vm_id) {
+    EventSlot_t slot = Simulator.NewEvent(MIGRATION_COMPLETION);
+    Simulator.GetEvent(slot).vm_id = vm_id;
+    Simulator.AddEvent(time, slot);
+}
+
+void ScheduleNewTask(Time_t time, TaskId_t task_id) {
+    Simulator.AddArrival(time, task_id);
+}
+
+void ScheduleTaskCompletion(Time_t time, MachineId_t machine_id, unsigned core_id) {
+    SimOutput("ScheduleTaskCompletion(): Scheduling task completion for core " + to_string(core_id) + " machine " + to_string(machine_id) + " at time " + to_string(time), 4);
+    EventSlot_t slot = Simulator.NewEvent(TASK_COMPLETION);
+    Event_t & event = Simulator.GetEvent(slot);
+    event.machine_id = machine_id;
+    event.core_id = core_id;
+    Simulator.AddEvent(time, slot);
+}
+
+void ScheduleTimer(Time_t time) {
+    EventSlot_t slot = Simulator.NewEvent(TIMER);
+    Simulator.AddEvent(time, slot);
+}
+
+Time_t Now() {
+    return Simulator.Now();
+}
@@ -0,0 +1,115 @@
+//
+//  Standby.cpp
+//  CloudSim
+//
+
+#include <algorithm>
+
+#include "Standby.hpp"
+
+// Share of the tasks of each SLA that must find an idle core
+static const double SLA_TARGET[NUM_SLAS] = {0.95, 0.90, 0.80, 0.0};
+// Weight of the newest sample in the smoothed runtime
+static const double SMOOTHING = 0.25;
+// A rate that goes up is taken at once, one that goes down is followed over this long, in us
+static const double RATE_DECAY = 4000000.0;
+// How long a strict SLA keeps its CPU type sized for it after its last arrival, in us
+static const Time_t SLA_MEMORY = 10000000;
+
+void StandbyPlanner::Init(unsigned floor_percent) {
+    Pool_t empty = {};
+    empty.strictest = SLA3;
+    pools.assign(CPU_TYPES, empty);
+    for(MachineId_t machine_id = 0; machine_id < Machine_GetTotal(); machine_id++) {
+        const MachineInfo_t & info = Machine_GetInfoRef(machine_id);
+        Pool_t & pool = pools[info.cpu];
+        pool.machines++;
+        pool.cores += info.num_cpus;
+        pool.mips += double(info.num_cpus) * Machine_GetClassInfo(machine_id).performance[P0];
+    }
+    hosts.assign(CPU_TYPES, 0);
+    for(unsigned cpu = 0; cpu < CPU_TYPES; cpu++) {
+        if(pools[cpu].cores > 0) {
+            pools[cpu].mips /= pools[cpu].cores;
+        }
+        pools[cpu].floor = (pools[cpu].machines * floor_percent + 99) / 100;
+        hosts[cpu] = pools[cpu].floor;
+    }
+    last_evaluation = 0;
+}
+
+void StandbyPlanner::TaskArrived(TaskId_t task_id) {
+    const TaskInfo_t & task = GetTaskInfoRef(task_id);
+    pools[task.required_cpu].arrivals[task.required_sla]++;
+}
+
+void StandbyPlanner::TaskCompleted(TaskId_t task_id) {
+    const TaskInfo_t & task = GetTaskInfoRef(task_id);
+    Pool_t & pool = pools[task.required_cpu];
+    if(pool.mips == 0.0) {
+        return;
+    }
+    // What the task needs on a core of its own, MIPS being instructions per us
+    double runtime = task.total_instructions / pool.mips;
+    pool.runtime = pool.runtime == 0.0 ? runtime : (1.0 - SMOOTHING) * pool.runtime + SMOOTHING * runtime;
+}
+
+// Erlang C through the Erlang B recursion, which stays stable for large loads. Returns
+// the fewest cores, up to all of them, that keep the chance of finding no idle core
+// within 1 - target, or just enough cores for the load when there is no target.
+unsigned StandbyPlanner::Servers(double load, double target, unsigned cores) const {
+    if(load <= 0.0) {
+        return 0;
+    }
+    double erlang_b = 1.0;
+    for(unsigned servers = 1; servers <= cores; servers++) {
+        erlang_b = load * erlang_b / (servers + load * erlang_b);
+        if(servers <= load) {
+            continue;
+        }
+        double erlang_c = servers * erlang_b / (servers - load * (1.0 - erlang_b));
+        if(erlang_c <= 1.0 - target) {
+            return servers;
+        }
+    }
+    return cores;
+}
+
+void StandbyPlanner::Evaluate(Time_t now) {
+    if(now <= last_evaluation) {
+        return;
+    }
+    double elapsed = double(now - last_evaluation);
+    last_evaluation = now;
+    for(unsigned cpu = 0; cpu < CPU_TYPES; cpu++) {
+        Pool_t & pool = pools[cpu];
+        unsigned arrivals = 0;
+        for(unsigned sla = 0; sla < NUM_SLAS; sla++) {
+            arrivals += pool.arrivals[sla];
+        }
+        double rate = arrivals / elapsed;
+        double weight = min(1.0, elapsed / RATE_DECAY);
+        pool.rate = rate >= pool.rate ? rate : (1.0 - weight) * pool.rate + weight * rate;
+        if(now - pool.strictest_seen > SLA_MEMORY) {
+            pool.strictest = SLA3;
+        }
+        for(unsigned sla = 0; sla < NUM_SLAS; sla++) {
+            if(pool.arrivals[sla] > 0) {
+                if(sla <= unsigned(pool.strictest)) {
+                    pool.strictest = SLAType_t(sla);
+                    pool.strictest_seen = now;
+                }
+                break;
+            }
+        }
+        for(unsigned sla = 0; sla < NUM_SLAS; sla++) {
+            pool.arrivals[sla] = 0;
+        }
+        if(pool.machines == 0 || pool.runtime == 0.0) {
+            continue;
+        }
+        unsigned servers = Servers(pool.rate * pool.runtime, SLA_TARGET[pool.strictest], pool.cores);
+        // Cores to machines, rounding up
+        hosts[cpu] = max(pool.floor, unsigned((uint64_t(servers) * pool.machines + pool.cores - 1) / pool.cores));
+    }
+}
@@ -0,0 +1,53 @@
+//
+//  Standby.hpp
+//  CloudSim
+//
+
+#ifndef Standby_hpp
+#define Standby_hpp
+
+#include <vector>
+
+#include "Interfaces.h"
+
+// Sizes the pool of awake machines of every CPU type. Each CPU type is taken as an M/M/c
+// queue whose servers are the cores of its awake machines: tasks arrive at the measured
+// rate and hold a core for the measured runtime, and a task that arrives while every core
+// is busy has to share one, which is where SLA violations come from. Erlang C gives the
+// probability of that, and the pool is the fewest machines that keep it within what the
+// strictest SLA that arrived lately allows (95%, 90% and 80% of tasks in time for SLA0-2).
+// A CPU type that only sees SLA3 work keeps just enough cores for its load.
+//
+// Arrivals are counted between two calls to Evaluate(). The arrival rate follows a burst
+// at once and decays slowly after it, and the runtime of a completed task is what its
+// instructions take on an average core of its CPU type at P0, so that a crowded machine
+// does not inflate the load it is sized for. Hosts() never answers less than the share of
+// the machines given to Init(), which is all it answers until a completion was seen.
+class StandbyPlanner {
+public:
+    void            Init(unsigned floor_percent);
+    void            Evaluate(Time_t now);
+    unsigned        Hosts(CPUType_t cpu) const                  { return hosts[cpu]; }
+    void            TaskArrived(TaskId_t task_id);
+    void            TaskCompleted(TaskId_t task_id);
+private:
+    typedef struct {
+        unsigned    machines;
+        unsigned    floor;                  // Machines kept up whatever the load
+        unsigned    cores;
+        double      mips;                   // Of a core at P0, on average
+        unsigned    arrivals[NUM_SLAS];     // Since the last evaluation
+        double      rate;                   // Tasks per us
+        double      runtime;                // In us
+        SLAType_t   strictest;              // Of the tasks that arrived lately
+        Time_t      strictest_seen;
+    } Pool_t;
+
+    unsigned        Servers(double load, double target, unsigned cores) const;
+
+    vector<Pool_t>  pools;
+    vector<unsigned> hosts;
+    Time_t          last_evaluation = 0;
+};
+
+#endif /* Standby_hpp */
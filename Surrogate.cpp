@@ -0,0 +1,245 @@
+//
+//  Surrogate.cpp
+//  CloudSim
+//
+
+#include <algorithm>
+#include <limits>
+
+#include "Surrogate.hpp"
+
+// How far ahead every host is rolled, in us, well past the MIGRATION_LATENCY a move costs
+static const double HORIZON = 60000000.0;
+// A late SLA0-2 task costs as much as its host idling, for every time over that its most
+// pressed task needs what it gets, up to MAX_LATENESS times
+static const double LATE_WEIGHT = 1.0;
+static const double MAX_LATENESS = 100.0;
+// Need of a task that a migration would make miss its target
+static const float OVERDUE = numeric_limits<float>::infinity();
+
+void ClusterSurrogate::Init(bool (*movable)(VMId_t vm_id), bool (*may_sleep)(MachineId_t machine_id)) {
+    this->movable = movable;
+    this->may_sleep = may_sleep;
+    unsigned total = Machine_GetTotal();
+    cores.resize(total);
+    idle_power.resize(total);
+    sleep_power.resize(total);
+    for(unsigned p = 0; p < P_STATES; p++) {
+        core_power[p].resize(total);
+        mips[p].resize(total);
+    }
+    for(MachineId_t machine_id = 0; machine_id < total; machine_id++) {
+        const MachineClassInfo_t & info = Machine_GetClassInfo(machine_id);
+        cores[machine_id] = float(info.num_cpus);
+        idle_power[machine_id] = float(info.s_states[S0] + info.num_cpus * info.c_states[C1]);
+        sleep_power[machine_id] = float(info.s_states[S5] + info.num_cpus * info.c_states[C4]);
+        for(unsigned p = 0; p < P_STATES; p++) {
+            core_power[p][machine_id] = float(info.p_states[p]) - float(info.c_states[C1]);
+            mips[p][machine_id] = float(info.performance[p]);
+        }
+    }
+    tasks.assign(total, 0);
+    risky.assign(total, 0);
+    need.assign(total, 0.0f);
+    runner_up.assign(total, 0.0f);
+    remaining.assign(total, 0.0);
+    p_state.assign(total, P0);
+    awake.assign(total, 0);
+    cost.assign(total, 0.0);
+    smallest.assign(total, NO_VM);
+}
+
+void ClusterSurrogate::Refresh(const vector<VMId_t> & vms, Time_t now) {
+    unsigned total = Machine_GetTotal();
+    journal.clear();
+    fill(tasks.begin(), tasks.end(), 0);
+    fill(risky.begin(), risky.end(), 0);
+    fill(need.begin(), need.end(), 0.0f);
+    fill(runner_up.begin(), runner_up.end(), 0.0f);
+    fill(remaining.begin(), remaining.end(), 0.0);
+    fill(smallest.begin(), smallest.end(), NO_VM);
+    for(MachineId_t machine_id = 0; machine_id < total; machine_id++) {
+        const MachineInfo_t & info = Machine_GetInfoRef(machine_id);
+        p_state[machine_id] = info.p_state;
+        awake[machine_id] = info.s_state == S0;
+    }
+    VMId_t top = 0;
+    for(VMId_t vm_id : vms) {
+        top = max(top, vm_id + 1);
+    }
+    residents.assign(top, {NO_MACHINE, {}, 0.0f});
+    for(VMId_t vm_id : vms) {
+        if(!movable(vm_id)) {
+            continue;
+        }
+        const VMInfo_t & info = VM_GetInfoRef(vm_id);
+        Resident_t & resident = residents[vm_id];
+        resident.machine_id = info.machine_id;
+        for(TaskId_t task_id : info.active_tasks) {
+            const TaskInfo_t & task = GetTaskInfoRef(task_id);
+            resident.load.tasks++;
+            resident.load.remaining += double(task.remaining_instructions);
+            // a task past its target has missed it already, wherever it runs
+            if(task.required_sla == SLA3 || task.target_completion <= now) {
+                continue;
+            }
+            resident.load.risky++;
+            Time_t left = task.target_completion - now;
+            float here = float(task.remaining_instructions / double(left));
+            float moved = left > MIGRATION_LATENCY ? float(task.remaining_instructions / double(left - MIGRATION_LATENCY)) : OVERDUE;
+            resident.load.need = max(resident.load.need, here);
+            resident.moved_need = max(resident.moved_need, moved);
+        }
+        MachineId_t machine_id = info.machine_id;
+        tasks[machine_id] += resident.load.tasks;
+        risky[machine_id] += resident.load.risky;
+        remaining[machine_id] += resident.load.remaining;
+        if(resident.load.need > need[machine_id]) {
+            runner_up[machine_id] = need[machine_id];
+            need[machine_id] = resident.load.need;
+        } else {
+            runner_up[machine_id] = max(runner_up[machine_id], resident.load.need);
+        }
+        if(resident.load.tasks > 0 && (smallest[machine_id] == NO_VM || resident.load.tasks < residents[smallest[machine_id]].load.tasks)) {
+            smallest[machine_id] = vm_id;
+        }
+    }
+    for(MachineId_t machine_id = 0; machine_id < total; machine_id++) {
+        cost[machine_id] = awake[machine_id] ? Cost(machine_id, LoadOf(machine_id), CPUPerformance_t(p_state[machine_id]), false)
+                                             : sleep_power[machine_id];
+    }
+}
+
+// Average power over the horizon plus the penalty for late tasks. A host stays up until
+// its work drains, even past the horizon, so that slowing a host down is not free, and a
+// host that a migration empties draws its idle power until the VM is gone and sleeps from
+// then on if it may.
+double ClusterSurrogate::Cost(MachineId_t machine_id, const Load_t & load, CPUPerformance_t p_state, bool emptied) const {
+    double idle = idle_power[machine_id];
+    if(load.tasks == 0) {
+        if(emptied && may_sleep(machine_id)) {
+            return (idle * MIGRATION_LATENCY + sleep_power[machine_id] * (HORIZON - MIGRATION_LATENCY)) / HORIZON;
+        }
+        return idle;
+    }
+    double busy = min(float(load.tasks), cores[machine_id]);
+    double rate = mips[p_state][machine_id];
+    double drain = load.remaining / (busy * rate);
+    double power = (idle * max(drain, HORIZON) + core_power[p_state][machine_id] * load.remaining / rate) / HORIZON;
+    double share = load.tasks <= cores[machine_id] ? 1.0 : cores[machine_id] / load.tasks;
+    double lateness = load.need / (share * rate);
+    if(load.risky > 0 && lateness > 1.0) {
+        power += load.risky * LATE_WEIGHT * idle * min(lateness, MAX_LATENESS);
+    }
+    return power;
+}
+
+ClusterSurrogate::Load_t ClusterSurrogate::LoadOf(MachineId_t machine_id) const {
+    return {tasks[machine_id], risky[machine_id], need[machine_id], runner_up[machine_id], remaining[machine_id]};
+}
+
+void ClusterSurrogate::Store(MachineId_t machine_id, const Load_t & load) {
+    tasks[machine_id] = load.tasks;
+    risky[machine_id] = load.risky;
+    need[machine_id] = load.need;
+    runner_up[machine_id] = load.runner_up;
+    remaining[machine_id] = load.remaining;
+}
+
+void ClusterSurrogate::Save(MachineId_t machine_id, VMId_t vm_id) {
+    Entry_t entry = {machine_id, LoadOf(machine_id), CPUPerformance_t(p_state[machine_id]), cost[machine_id], vm_id, {}};
+    if(vm_id != NO_VM) {
+        entry.resident = residents[vm_id];
+    }
+    journal.push_back(entry);
+}
+
+// Only the two largest needs are kept, so a host that loses several VMs can
+// overstate what the rest need
+ClusterSurrogate::Load_t ClusterSurrogate::Without(MachineId_t machine_id, VMId_t vm_id) const {
+    Load_t load = LoadOf(machine_id);
+    const Load_t & leaving = residents[vm_id].load;
+    load.tasks -= min(load.tasks, leaving.tasks);
+    load.risky -= min(load.risky, leaving.risky);
+    load.remaining = max(0.0, load.remaining - leaving.remaining);
+    if(leaving.need >= load.need) {
+        load.need = load.runner_up;
+    }
+    if(load.risky == 0) {
+        load.need = 0.0f;
+        load.runner_up = 0.0f;
+    }
+    return load;
+}
+
+ClusterSurrogate::Load_t ClusterSurrogate::With(MachineId_t machine_id, VMId_t vm_id) const {
+    Load_t load = LoadOf(machine_id);
+    const Resident_t & arriving = residents[vm_id];
+    load.tasks += arriving.load.tasks;
+    load.risky += arriving.load.risky;
+    load.remaining += arriving.load.remaining;
+    if(arriving.moved_need > load.need) {
+        load.runner_up = load.need;
+        load.need = arriving.moved_need;
+    } else {
+        load.runner_up = max(load.runner_up, arriving.moved_need);
+    }
+    return load;
+}
+
+double ClusterSurrogate::MoveDelta(VMId_t vm_id, MachineId_t machine_id) const {
+    if(vm_id >= residents.size() || residents[vm_id].machine_id == NO_MACHINE || residents[vm_id].machine_id == machine_id) {
+        return 0.0;
+    }
+    MachineId_t source = residents[vm_id].machine_id;
+    return Cost(source, Without(source, vm_id), CPUPerformance_t(p_state[source]), true) - cost[source]
+         + Cost(machine_id, With(machine_id, vm_id), CPUPerformance_t(p_state[machine_id]), false) - cost[machine_id];
+}
+
+void ClusterSurrogate::Move(VMId_t vm_id, MachineId_t machine_id) {
+    if(vm_id >= residents.size() || residents[vm_id].machine_id == NO_MACHINE || residents[vm_id].machine_id == machine_id) {
+        return;
+    }
+    MachineId_t source = residents[vm_id].machine_id;
+    Save(source, vm_id);
+    Save(machine_id, NO_VM);
+    Load_t from = Without(source, vm_id);
+    Load_t to = With(machine_id, vm_id);
+    Store(source, from);
+    Store(machine_id, to);
+    cost[source] = Cost(source, from, CPUPerformance_t(p_state[source]), true);
+    cost[machine_id] = Cost(machine_id, to, CPUPerformance_t(p_state[machine_id]), false);
+    Resident_t & resident = residents[vm_id];
+    resident.machine_id = machine_id;
+    resident.load.need = resident.moved_need;
+}
+
+double ClusterSurrogate::PStateDelta(MachineId_t machine_id, CPUPerformance_t p_state) const {
+    return Cost(machine_id, LoadOf(machine_id), p_state, false) - cost[machine_id];
+}
+
+void ClusterSurrogate::SetPState(MachineId_t machine_id, CPUPerformance_t p_state) {
+    Save(machine_id, NO_VM);
+    this->p_state[machine_id] = p_state;
+    cost[machine_id] = Cost(machine_id, LoadOf(machine_id), p_state, false);
+}
+
+double ClusterSurrogate::SleepDelta(MachineId_t machine_id) const {
+    if(!awake[machine_id] || tasks[machine_id] > 0) {
+        return 0.0;
+    }
+    return sleep_power[machine_id] - idle_power[machine_id];
+}
+
+void ClusterSurrogate::Rollback(size_t mark) {
+    while(journal.size() > mark) {
+        const Entry_t & entry = journal.back();
+        Store(entry.machine_id, entry.load);
+        p_state[entry.machine_id] = entry.p_state;
+        cost[entry.machine_id] = entry.cost;
+        if(entry.vm_id != NO_VM) {
+            residents[entry.vm_id] = entry.resident;
+        }
+        journal.pop_back();
+    }
+}
@@ -0,0 +1,105 @@
+//
+//  Surrogate.hpp
+//  CloudSim
+//
+
+#ifndef Surrogate_hpp
+#define Surrogate_hpp
+
+#include <vector>
+
+#include "Interfaces.h"
+
+#define NO_VM VMId_t(-1)        // No VM, e.g. on a host without a movable one
+
+// A coarse model of the cluster that rolls every host forward over a fixed horizon, so
+// that a scheduler can price what an action would do before it takes it. A host is
+// reduced to its task count, the instructions left on it and the rate its most pressed
+// SLA0-2 task needs to meet its target. Its tasks share the cores at its P-state until
+// the work drains, and the host idles for the rest of the horizon, or sleeps once a
+// migration empties it. The cost of a host is the average power it draws over the
+// horizon, plus a penalty for each of its SLA0-2 tasks when the most pressed one would be
+// late, which grows with how much more it needs than it gets. A VM that migrates stops
+// for MIGRATION_LATENCY, which leaves its tasks that much less time. Deltas are in the
+// units of the power tables.
+//
+// Refresh() rebuilds the hosts from the VMs in one pass over their tasks and prices all
+// of them in a single loop over flat per-host arrays. After that, pricing a move or a
+// P-state change only re-prices the one or two hosts it touches. Move() and SetPState()
+// apply an action to the model so that the next ones are priced against it, and
+// Rollback() undoes every action applied since Mark(), which lets a scheduler try out a
+// plan of several moves and keep it only if it pays off.
+//
+// VMs that are not movable, e.g. because they are already migrating, are left out, and a
+// host that is emptied only goes to sleep in the model where may_sleep() allows it.
+class ClusterSurrogate {
+public:
+    void            Init(bool (*movable)(VMId_t vm_id), bool (*may_sleep)(MachineId_t machine_id));
+    void            Refresh(const vector<VMId_t> & vms, Time_t now);
+
+    double          MoveDelta(VMId_t vm_id, MachineId_t machine_id) const;
+    double          PStateDelta(MachineId_t machine_id, CPUPerformance_t p_state) const;
+    double          SleepDelta(MachineId_t machine_id) const;
+    void            Move(VMId_t vm_id, MachineId_t machine_id);
+    void            SetPState(MachineId_t machine_id, CPUPerformance_t p_state);
+    size_t          Mark() const                                { return journal.size(); }
+    void            Rollback(size_t mark);
+
+    VMId_t          Smallest(MachineId_t machine_id) const      { return smallest[machine_id]; }
+    unsigned        Tasks(MachineId_t machine_id) const         { return tasks[machine_id]; }
+private:
+    typedef struct {
+        unsigned    tasks;
+        unsigned    risky;          // SLA0-2 tasks
+        float       need;           // Instructions per us the most pressed of them needs
+        float       runner_up;      // The same for the next VM, once the first one leaves
+        double      remaining;      // Instructions
+    } Load_t;
+    typedef struct {
+        MachineId_t machine_id;     // NO_MACHINE for a VM that is left out
+        Load_t      load;           // need is what the tasks need where they run now
+        float       moved_need;     // What they need once they have migrated
+    } Resident_t;
+    typedef struct {                // What an action changed, to undo it
+        MachineId_t machine_id;
+        Load_t      load;
+        CPUPerformance_t p_state;
+        double      cost;
+        VMId_t      vm_id;          // NO_VM when no VM moved
+        Resident_t  resident;
+    } Entry_t;
+
+    double          Cost(MachineId_t machine_id, const Load_t & load, CPUPerformance_t p_state, bool emptied) const;
+    Load_t          LoadOf(MachineId_t machine_id) const;
+    void            Save(MachineId_t machine_id, VMId_t vm_id);
+    void            Store(MachineId_t machine_id, const Load_t & load);
+    Load_t          Without(MachineId_t machine_id, VMId_t vm_id) const;
+    Load_t          With(MachineId_t machine_id, VMId_t vm_id) const;
+
+    bool            (*movable)(VMId_t vm_id) = nullptr;
+    bool            (*may_sleep)(MachineId_t machine_id) = nullptr;
+
+    // Fixed per host
+    vector<float>   cores;
+    vector<float>   idle_power;                 // S0 draw with every core in C1
+    vector<float>   sleep_power;                // S5 draw with every core in C4
+    vector<float>   core_power[P_STATES];       // What a busy core adds to the idle draw
+    vector<float>   mips[P_STATES];
+
+    // Rebuilt by Refresh()
+    vector<unsigned> tasks;
+    vector<unsigned> risky;
+    vector<float>   need;
+    vector<float>   runner_up;
+    vector<double>  remaining;
+    vector<unsigned char> p_state;
+    vector<unsigned char> awake;
+    vector<double>  cost;
+    vector<VMId_t>  smallest;                   // Movable VM with the fewest tasks, per host
+
+    vector<Resident_t> residents;               // Indexed by VM id
+
+    vector<Entry_t> journal;
+};
+
+#endif /* Surrogate_hpp */
@@ -0,0 +1,297 @@
+//
+//  Task.cpp
+//  CloudSim
+//
+//  Created by ELMOOTAZBELLAH ELNOZAHY on 10/20/24.
+//
+
+#include <algorithm>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Interfaces.h"
+#include "Internal_Interfaces.h"
+
+#define TASK_CHUNK_BITS     16          // Records per chunk of an arena, as a power of two
+
+// Tasks are packed into two records, kept apart so that the simulator's inner loops only
+// pull in the small one. The hot record is what changes while a task runs, with its enums
+// and flags in bit fields, and the cold record is what is fixed when the task is added,
+// the enums as bytes. Together they take 56 bytes a task.
+//
+// A TaskInfo_t is only filled in for a task somebody asked GetTaskInfoRef() about, and
+// from then on it is kept up to date alongside the records. Every task has its own slot
+// in the views, indexed by task id like the records, and the chunks of views are only
+// allocated as far as the highest task asked about. A view therefore stays valid, and
+// stays the view of its task, for the rest of the run.
+//
+// Records and views live in arenas of fixed size chunks: adding a task never moves the
+// others, so a view stays where it is while tasks are added, and a run with tens of
+// millions of tasks never needs one big block or the copy of a vector that grows.
+template <typename Record> class Arena {
+public:
+    ~Arena();
+    Record &        operator[](size_t index)    { return table[index >> TASK_CHUNK_BITS][index & (CHUNK - 1)]; }
+    size_t          Add(const Record & record);
+    void            Grow(size_t size);
+    size_t          Size() const                { return size; }
+private:
+    static const size_t CHUNK = size_t(1) << TASK_CHUNK_BITS;
+
+    vector<Record *> chunks;
+    Record **       table = nullptr;            // chunks.data(), so that a lookup is two loads
+    size_t          size = 0;
+};
+
+template <typename Record> Arena<Record>::~Arena() {
+    for(Record * chunk : chunks) {
+        delete[] chunk;
+    }
+}
+
+template <typename Record> size_t Arena<Record>::Add(const Record & record) {
+    if(size == chunks.size() * CHUNK) {
+        chunks.push_back(new Record[CHUNK]);
+        table = chunks.data();
+    }
+    table[size >> TASK_CHUNK_BITS][size & (CHUNK - 1)] = record;
+    return size++;
+}
+
+template <typename Record> void Arena<Record>::Grow(size_t size) {
+    while(chunks.size() * CHUNK < size) {
+        chunks.push_back(new Record[CHUNK]);
+        table = chunks.data();
+    }
+    this->size = max(this->size, size);
+}
+
+typedef struct {
+    uint64_t        remaining_instructions;
+    uint32_t        memory;
+    uint32_t        priority : 2;
+    uint32_t        completed : 1;
+    uint32_t        gpu_capable : 1;
+    uint32_t        coasting : 1;               // remaining_instructions may lag, see SetTaskCoasting()
+    uint32_t        viewed : 1;                 // The task's view is in use and kept up to date
+} Hot_t;
+
+typedef struct {
+    uint64_t        total_instructions;
+    Time_t          arrival;
+    Time_t          target_completion;
+    Time_t          completion;
+    uint8_t         sla;
+    uint8_t         cpu;
+    uint8_t         vm;
+    uint8_t         task_class;
+} Cold_t;
+
+// A task id is the index of the task's records and of its view
+static Arena<Hot_t>     Hot;
+static Arena<Cold_t>    Cold;
+static Arena<TaskInfo_t> Views;
+static unsigned     Active_tasks = 0;
+
+// Per SLA class: tasks that completed and how many of them missed their target
+static struct {
+    unsigned completed;
+    unsigned violations;
+} sla_stats[NUM_SLAS];
+
+static TaskInfo_t Decode(TaskId_t task_id) {
+    const Hot_t & hot = Hot[task_id];
+    const Cold_t & cold = Cold[task_id];
+    TaskInfo_t info;
+    info.completed = hot.completed;
+    info.total_instructions = cold.total_instructions;
+    info.remaining_instructions = hot.remaining_instructions;
+    info.arrival = cold.arrival;
+    info.completion = cold.completion;
+    info.target_completion = cold.target_completion;
+    info.gpu_capable = hot.gpu_capable;
+    info.priority = Priority_t(hot.priority);
+    info.required_cpu = CPUType_t(cold.cpu);
+    info.required_memory = hot.memory;
+    info.required_sla = SLAType_t(cold.sla);
+    info.required_vm = VMType_t(cold.vm);
+    info.task_class = TaskClass_t(cold.task_class);
+    info.task_id = task_id;
+    return info;
+}
+
+// A task that coasts on its core is charged for the quanta it ran through only when the
+// machine settles it, so a scheduler that looks at the task settles it first
+static void Settle(TaskId_t task_id) {
+    if(Hot[task_id].coasting) {
+        Machine_SettleTask(task_id);
+    }
+}
+
+static TaskInfo_t * ViewOf(TaskId_t task_id) {
+    return Hot[task_id].viewed ? &Views[task_id] : nullptr;
+}
+
+static void CompletionReport(TaskId_t task_id) {
+    const Cold_t & cold = Cold[task_id];
+    SimOutput("Task::CompletionReport(): " + to_string(task_id) + " arrived at " + to_string(cold.arrival) + " with a runtime of " + to_string(cold.total_instructions / 1000) + " and target of " + to_string(cold.target_completion) + " and Completed at " + to_string(cold.completion), 4);
+}
+
+static bool IsViolated(TaskId_t task_id) {
+    const Cold_t & cold = Cold[task_id];
+    return cold.sla != SLA3 && Hot[task_id].completed && cold.completion > cold.target_completion;
+}
+
+static void ValidateTaskId(TaskId_t task_id, const char * caller) {
+    if(task_id >= Hot.Size()) {
+        ThrowException(string(caller) + "(): Invalid task id " + to_string(task_id));
+    }
+}
+
+// Public interface below
+
+unsigned GetNumTasks() {
+    return unsigned(Hot.Size());
+}
+
+TaskInfo_t GetTaskInfo(TaskId_t task_id) {
+    ValidateTaskId(task_id, "GetTaskInfo");
+    Settle(task_id);
+    return Decode(task_id);
+}
+
+const TaskInfo_t & GetTaskInfoRef(TaskId_t task_id) {
+    ValidateTaskId(task_id, "GetTaskInfoRef");
+    Settle(task_id);
+    Hot_t & hot = Hot[task_id];
+    if(!hot.viewed) {
+        Views.Grow(size_t(task_id) + 1);
+        Views[task_id] = Decode(task_id);
+        hot.viewed = true;
+    }
+    return Views[task_id];
+}
+
+unsigned GetTaskMemory(TaskId_t task_id) {
+    ValidateTaskId(task_id, "GetTaskMemory");
+    return Hot[task_id].memory;
+}
+
+unsigned GetTaskPriority(TaskId_t task_id) {
+    ValidateTaskId(task_id, "GetTaskPriority");
+    return Hot[task_id].priority;
+}
+
+double GetSLAReport(SLAType_t sla) {
+    double ratio = sla_stats[sla].completed == 0 ? 0.0 : double(sla_stats[sla].violations) / double(sla_stats[sla].completed);
+    return ratio * 100.0;
+}
+
+unsigned GetSLACompleted(SLAType_t sla) {
+    return sla_stats[sla].completed;
+}
+
+unsigned GetSLAViolations(SLAType_t sla) {
+    return sla_stats[sla].violations;
+}
+
+bool IsSLAViolated(TaskId_t task_id) {
+    ValidateTaskId(task_id, "IsSLAViolated");
+    return IsViolated(task_id);
+}
+
+bool IsTaskCompleted(TaskId_t task_id) {
+    ValidateTaskId(task_id, "IsTaskCompleted");
+    return Hot[task_id].remaining_instructions == 0;
+}
+
+bool IsTaskGPUCapable(TaskId_t task_id) {
+    ValidateTaskId(task_id, "IsTaskGPUCapable");
+    return Hot[task_id].gpu_capable;
+}
+
+CPUType_t RequiredCPUType(TaskId_t task_id) {
+    ValidateTaskId(task_id, "RequiredCPUType");
+    return CPUType_t(Cold[task_id].cpu);
+}
+
+SLAType_t RequiredSLA(TaskId_t task_id) {
+    ValidateTaskId(task_id, "RequiredSLA");
+    return SLAType_t(Cold[task_id].sla);
+}
+
+VMType_t RequiredVMType(TaskId_t task_id) {
+    ValidateTaskId(task_id, "RequiredVMType");
+    return VMType_t(Cold[task_id].vm);
+}
+
+void SetTaskPriority(TaskId_t task_id, Priority_t priority) {
+    ValidateTaskId(task_id, "SetTaskPriority");
+    Hot[task_id].priority = priority;
+    if(TaskInfo_t * view = ViewOf(task_id)) {
+        view->priority = priority;
+    }
+}
+
+// Internal interface below
+
+TaskId_t AddTask(uint64_t inst, Time_t arr, Time_t trgt, VMType_t vm, SLAType_t sla, CPUType_t cpu, bool gpu, unsigned mem, TaskClass_t task_class) {
+    Hot_t hot;
+    hot.remaining_instructions = inst;
+    hot.memory = mem;
+    hot.priority = MID_PRIORITY;
+    hot.completed = false;
+    hot.gpu_capable = gpu;
+    hot.coasting = false;
+    hot.viewed = false;
+    Cold_t cold = {inst, arr, trgt, 0, uint8_t(sla), uint8_t(cpu), uint8_t(vm), uint8_t(task_class)};
+    TaskId_t task_id = TaskId_t(Hot.Add(hot));
+    Cold.Add(cold);
+    ScheduleNewTask(arr, task_id);
+    Active_tasks++;
+    return task_id;
+}
+
+void CompleteTask(TaskId_t task_id) {
+    ValidateTaskId(task_id, "CompleteTask");
+    Hot[task_id].completed = true;
+    Cold[task_id].completion = Now();
+    if(TaskInfo_t * view = ViewOf(task_id)) {
+        view->completed = true;
+        view->completion = Now();
+    }
+    SLAType_t sla = SLAType_t(Cold[task_id].sla);
+    sla_stats[sla].completed++;
+    bool violated = IsViolated(task_id);
+    Metrics_TaskCompleted(sla, violated);
+    Trace_TaskCompleted(task_id, violated);
+    if(violated) {
+        sla_stats[sla].violations++;
+        SLAWarning(Now(), task_id);
+    }
+    Active_tasks--;
+    CompletionReport(task_id);
+}
+
+unsigned GetActiveTasks() {
+    return Active_tasks;
+}
+
+uint64_t GetRemainingInstructions(TaskId_t task_id) {
+    ValidateTaskId(task_id, "GetRemainingInstructions");
+    return Hot[task_id].remaining_instructions;
+}
+
+void SetTaskCoasting(TaskId_t task_id, bool coasting) {
+    Hot[task_id].coasting = coasting;
+}
+
+void SetRemainingInstructions(TaskId_t task_id, uint64_t instructions) {
+    ValidateTaskId(task_id, "SetRemainingInstructions");
+    SimOutput("Task::SetRemainingInstructions for task " + to_string(task_id) + " Remaining instruction " + to_string(instructions), 4);
+    Hot[task_id].remaining_instructions = instructions;
+    if(TaskInfo_t * view = ViewOf(task_id)) {
+        view->remaining_instructions = instructions;
+    }
+}
@@ -0,0 +1,292 @@
+//
+//  Telemetry.cpp
+//  CloudSim
+//
+
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Interfaces.h"
+#include "Internal_Interfaces.h"
+
+#define TELEMETRY_SLOTS     64          // Samples the ring holds before the simulation waits for the writer
+
+// Time series of the cluster, off unless CLOUDSIM_TELEMETRY names a file. Every timer
+// tick, right before SchedulerCheck(), the S-state, P-state, memory in use, active tasks
+// and energy of every machine are sampled, together with how many tasks of each SLA have
+// completed and how many of those missed their target.
+//
+// Samples go into a ring of TELEMETRY_SLOTS that is allocated once, one array per field
+// (columns), so taking a sample is a handful of stores per machine and one lock to
+// publish it. A writer thread drains the ring to the file. If the writer falls behind by
+// a whole ring, the simulation waits for it rather than drop samples.
+//
+// CLOUDSIM_TELEMETRY_FORMAT picks the file format, "csv" (the default) or "binary". The
+// CSV file has an S line per sample with the SLA counters and an M line per machine:
+//     S,time,completed0,violations0,...,completed3,violations3
+//     M,time,machine,s_state,p_state,memory_used,active_tasks,energy
+// The binary file starts with "CSTM", a format version and the machine count, all 32 bit,
+// followed per sample by the time (64 bit), the completed and violation counters (32 bit
+// each, by SLA) and the columns in the order of the M line, at 8, 8, 32, 32 and 64 bits.
+// Numbers are in the byte order of the machine that wrote them.
+//
+// A forked variant samples to CLOUDSIM_TELEMETRY.n from the fork on.
+class TelemetryRecorder {
+public:
+    ~TelemetryRecorder();
+    void            Start();
+    void            Sample(Time_t time);
+    void            Suspend();
+    void            Resume(unsigned variant);
+    void            Stop();
+private:
+    void            Append(uint64_t value, char separator);
+    void            Open(const string & name);
+    void            Write();
+    void            WriteBinary(unsigned slot);
+    void            WriteCSV(unsigned slot);
+
+    FILE *          file = nullptr;
+    string          path;
+    bool            binary = false;
+    unsigned        machines = 0;
+
+    // Columns, TELEMETRY_SLOTS samples of machines entries each
+    vector<Time_t>  times;
+    vector<uint32_t> completed;                 // NUM_SLAS per sample
+    vector<uint32_t> violations;
+    vector<uint8_t> s_states;
+    vector<uint8_t> p_states;
+    vector<uint32_t> memory_used;
+    vector<uint32_t> active_tasks;
+    vector<uint64_t> energy;
+
+    thread          writer;
+    mutex           lock;
+    condition_variable filled;
+    condition_variable drained;
+    uint64_t        head = 0;                   // Samples taken
+    uint64_t        tail = 0;                   // Samples written
+    bool            stop = false;
+    vector<char>    text;                       // A CSV sample being formatted
+};
+
+static TelemetryRecorder telemetry;
+
+TelemetryRecorder::~TelemetryRecorder() {
+    Stop();
+}
+
+void TelemetryRecorder::Open(const string & name) {
+    file = fopen(name.c_str(), binary ? "wb" : "w");
+    if(file == NULL) {
+        ThrowException("Telemetry(): Could not open ", name);
+    }
+    if(binary) {
+        uint32_t header[3];
+        memcpy(&header[0], "CSTM", 4);
+        header[1] = 1;
+        header[2] = machines;
+        fwrite(header, sizeof(header), 1, file);
+    }
+    else {
+        fputs("S,time", file);
+        for(unsigned sla = 0; sla < NUM_SLAS; sla++) {
+            fprintf(file, ",completed%u,violations%u", sla, sla);
+        }
+        fputs("\nM,time,machine,s_state,p_state,memory_used,active_tasks,energy\n", file);
+    }
+}
+
+void TelemetryRecorder::Start() {
+    const char * name = getenv("CLOUDSIM_TELEMETRY");
+    if(name == NULL || file != nullptr) {
+        return;
+    }
+    const char * format = getenv("CLOUDSIM_TELEMETRY_FORMAT");
+    if(format != NULL) {
+        if(strcmp(format, "binary") == 0) {
+            binary = true;
+        }
+        else if(strcmp(format, "csv") != 0) {
+            ThrowException("Telemetry(): Unknown format ", format);
+        }
+    }
+    path = name;
+    machines = Machine_GetTotal();
+    times.assign(TELEMETRY_SLOTS, 0);
+    completed.assign(TELEMETRY_SLOTS * NUM_SLAS, 0);
+    violations.assign(TELEMETRY_SLOTS * NUM_SLAS, 0);
+    s_states.assign(size_t(TELEMETRY_SLOTS) * machines, 0);
+    p_states.assign(size_t(TELEMETRY_SLOTS) * machines, 0);
+    memory_used.assign(size_t(TELEMETRY_SLOTS) * machines, 0);
+    active_tasks.assign(size_t(TELEMETRY_SLOTS) * machines, 0);
+    energy.assign(size_t(TELEMETRY_SLOTS) * machines, 0);
+    Open(path);
+    Resume(0);
+}
+
+void TelemetryRecorder::Sample(Time_t time) {
+    if(file == nullptr) {
+        return;
+    }
+    {
+        unique_lock<mutex> guard(lock);
+        drained.wait(guard, [&] { return head - tail < TELEMETRY_SLOTS; });
+    }
+    // The writer only reads the slots between tail and head, so this one is ours
+    unsigned slot = unsigned(head % TELEMETRY_SLOTS);
+    times[slot] = time;
+    for(unsigned sla = 0; sla < NUM_SLAS; sla++) {
+        completed[slot * NUM_SLAS + sla] = GetSLACompleted(SLAType_t(sla));
+        violations[slot * NUM_SLAS + sla] = GetSLAViolations(SLAType_t(sla));
+    }
+    size_t base = size_t(slot) * machines;
+    for(MachineId_t machine_id = 0; machine_id < machines; machine_id++) {
+        const MachineInfo_t & info = Machine_GetInfoRef(machine_id);
+        s_states[base + machine_id] = uint8_t(info.s_state);
+        p_states[base + machine_id] = uint8_t(info.p_state);
+        memory_used[base + machine_id] = info.memory_used;
+        active_tasks[base + machine_id] = info.active_tasks;
+        energy[base + machine_id] = info.energy_consumed;
+    }
+    lock_guard<mutex> guard(lock);
+    head++;
+    filled.notify_one();
+}
+
+void TelemetryRecorder::Append(uint64_t value, char separator) {
+    char digits[20];
+    unsigned length = 0;
+    do {
+        digits[length++] = char('0' + value % 10);
+        value /= 10;
+    } while(value != 0);
+    while(length > 0) {
+        text.push_back(digits[--length]);
+    }
+    text.push_back(separator);
+}
+
+void TelemetryRecorder::WriteCSV(unsigned slot) {
+    text.clear();
+    text.push_back('S');
+    text.push_back(',');
+    Append(times[slot], ',');
+    for(unsigned sla = 0; sla < NUM_SLAS; sla++) {
+        Append(completed[slot * NUM_SLAS + sla], ',');
+        Append(violations[slot * NUM_SLAS + sla], sla + 1 < NUM_SLAS ? ',' : '\n');
+    }
+    size_t base = size_t(slot) * machines;
+    for(MachineId_t machine_id = 0; machine_id < machines; machine_id++) {
+        text.push_back('M');
+        text.push_back(',');
+        Append(times[slot], ',');
+        Append(machine_id, ',');
+        Append(s_states[base + machine_id], ',');
+        Append(p_states[base + machine_id], ',');
+        Append(memory_used[base + machine_id], ',');
+        Append(active_tasks[base + machine_id], ',');
+        Append(energy[base + machine_id], '\n');
+    }
+    fwrite(text.data(), 1, text.size(), file);
+}
+
+void TelemetryRecorder::WriteBinary(unsigned slot) {
+    size_t base = size_t(slot) * machines;
+    fwrite(&times[slot], sizeof(Time_t), 1, file);
+    for(unsigned sla = 0; sla < NUM_SLAS; sla++) {
+        fwrite(&completed[slot * NUM_SLAS + sla], sizeof(uint32_t), 1, file);
+        fwrite(&violations[slot * NUM_SLAS + sla], sizeof(uint32_t), 1, file);
+    }
+    fwrite(&s_states[base], sizeof(uint8_t), machines, file);
+    fwrite(&p_states[base], sizeof(uint8_t), machines, file);
+    fwrite(&memory_used[base], sizeof(uint32_t), machines, file);
+    fwrite(&active_tasks[base], sizeof(uint32_t), machines, file);
+    fwrite(&energy[base], sizeof(uint64_t), machines, file);
+}
+
+void TelemetryRecorder::Write() {
+    unique_lock<mutex> guard(lock);
+    while(true) {
+        filled.wait(guard, [&] { return head > tail || stop; });
+        if(head == tail) {
+            break;
+        }
+        uint64_t end = head;
+        guard.unlock();
+        for(uint64_t sample = tail; sample < end; sample++) {
+            if(binary) {
+                WriteBinary(unsigned(sample % TELEMETRY_SLOTS));
+            }
+            else {
+                WriteCSV(unsigned(sample % TELEMETRY_SLOTS));
+            }
+        }
+        guard.lock();
+        tail = end;
+        drained.notify_one();
+    }
+}
+
+// Drains the ring and stops the writer, leaving the file open
+void TelemetryRecorder::Suspend() {
+    if(!writer.joinable()) {
+        return;
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        stop = true;
+    }
+    filled.notify_one();
+    writer.join();
+    stop = false;
+    fflush(file);
+}
+
+// Restarts the writer, a forked variant on a file of its own
+void TelemetryRecorder::Resume(unsigned variant) {
+    if(file == nullptr || writer.joinable()) {
+        return;
+    }
+    if(variant != 0) {
+        fclose(file);
+        Open(path + "." + to_string(variant));
+    }
+    writer = thread(&TelemetryRecorder::Write, this);
+}
+
+void TelemetryRecorder::Stop() {
+    Suspend();
+    if(file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+void Telemetry_Start() {
+    telemetry.Start();
+}
+
+void Telemetry_Sample(Time_t time) {
+    telemetry.Sample(time);
+}
+
+void Telemetry_Suspend() {
+    telemetry.Suspend();
+}
+
+void Telemetry_Resume(unsigned variant) {
+    telemetry.Resume(variant);
+}
+
+void Telemetry_Stop() {
+    telemetry.Stop();
+}
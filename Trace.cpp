@@ -0,0 +1,299 @@
+//
+//  Trace.cpp
+//  CloudSim
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "Interfaces.h"
+#include "Internal_Interfaces.h"
+
+#define TRACE_BUFFER        (1 << 20)   // Bytes of events gathered before they go to the file
+
+// Timeline of the run in the Trace Event Format, which chrome://tracing and Perfetto
+// open, off unless CLOUDSIM_TRACE names a file. Every machine is a process and every VM a
+// thread within the machine it runs on, timestamps being simulated microseconds:
+//  - a task is a slice named after its SLA on its VM, from the time it is attached to a
+//    machine until it completes or its VM migrates away, and a migration is a slice on
+//    the VM at the source followed by a flow to where the VM lands;
+//  - the S-state and P-state of every machine are counter tracks;
+//  - a task that completes after its target is an instant event on its VM.
+//
+// Events are formatted by hand into one buffer that is written out when it fills up, so
+// tracing allocates nothing per event. Where each task runs is kept in an array indexed
+// by task id, allocated once. Every event comes from the main thread, as a parallel tick
+// only covers machines that neither complete a task nor finish an S-state change. A
+// forked variant traces to CLOUDSIM_TRACE.n from the fork on.
+class TraceWriter {
+public:
+    ~TraceWriter();
+    bool            Enabled() const             { return file != nullptr; }
+    void            Start();
+    void            Stop();
+    void            Suspend();
+    void            Resume(unsigned variant);
+
+    void            Counter(MachineId_t machine_id, const char * name, unsigned value);
+    void            Flow(char phase, VMId_t vm_id, MachineId_t machine_id);
+    void            Instant(TaskId_t task_id, const char * name);
+    void            Slice(const char * name, const char * category, MachineId_t machine_id, VMId_t vm_id, Time_t start, Time_t end, TaskId_t task_id);
+    void            TaskStarted(TaskId_t task_id, VMId_t vm_id, MachineId_t machine_id);
+    void            TaskStopped(TaskId_t task_id);
+private:
+    typedef struct {
+        Time_t      start;                      // NEVER_STARTED while not on a machine
+        MachineId_t machine_id;
+        VMId_t      vm_id;
+    } Placement_t;
+    static const Time_t NEVER_STARTED = UINT64_MAX;
+
+    void            Append(const char * text);
+    void            Append(uint64_t value);
+    void            Begin(const char * phase, MachineId_t machine_id);
+    void            End();
+    void            Flush();
+    void            Open(const string & name);
+
+    FILE *          file = nullptr;
+    string          path;
+    vector<char>    buffer;
+    bool            first = true;               // No event written yet, so none needs a separator
+    vector<Placement_t> tasks;                  // Indexed by task id
+};
+
+static TraceWriter trace;
+
+TraceWriter::~TraceWriter() {
+    Stop();
+}
+
+void TraceWriter::Append(const char * text) {
+    buffer.insert(buffer.end(), text, text + strlen(text));
+}
+
+void TraceWriter::Append(uint64_t value) {
+    char digits[20];
+    unsigned length = 0;
+    do {
+        digits[length++] = char('0' + value % 10);
+        value /= 10;
+    } while(value != 0);
+    while(length > 0) {
+        buffer.push_back(digits[--length]);
+    }
+}
+
+void TraceWriter::Flush() {
+    fwrite(buffer.data(), 1, buffer.size(), file);
+    buffer.clear();
+}
+
+// Opens an event with its phase, time and process
+void TraceWriter::Begin(const char * phase, MachineId_t machine_id) {
+    Append(first ? "[\n{\"ph\":\"" : ",\n{\"ph\":\"");
+    first = false;
+    Append(phase);
+    Append("\",\"ts\":");
+    Append(Now());
+    Append(",\"pid\":");
+    Append(machine_id);
+}
+
+void TraceWriter::End() {
+    Append("}");
+    if(buffer.size() >= TRACE_BUFFER) {
+        Flush();
+    }
+}
+
+void TraceWriter::Open(const string & name) {
+    file = fopen(name.c_str(), "w");
+    if(file == NULL) {
+        ThrowException("Trace(): Could not open ", name);
+    }
+    first = true;
+    for(MachineId_t machine_id = 0; machine_id < Machine_GetTotal(); machine_id++) {
+        const MachineInfo_t & info = Machine_GetInfoRef(machine_id);
+        Begin("M", machine_id);
+        Append(",\"name\":\"process_name\",\"args\":{\"name\":\"machine ");
+        Append(machine_id);
+        Append("\"}");
+        End();
+        Counter(machine_id, "S-state", info.s_state);
+        Counter(machine_id, "P-state", info.p_state);
+    }
+}
+
+void TraceWriter::Start() {
+    const char * name = getenv("CLOUDSIM_TRACE");
+    if(name == NULL || file != nullptr) {
+        return;
+    }
+    path = name;
+    buffer.reserve(TRACE_BUFFER + 4096);
+    tasks.assign(GetNumTasks(), {NEVER_STARTED, 0, 0});
+    Open(path);
+}
+
+void TraceWriter::Stop() {
+    if(file == nullptr) {
+        return;
+    }
+    Append(first ? "[]\n" : "\n]\n");
+    Flush();
+    fclose(file);
+    file = nullptr;
+}
+
+// Before a fork, so that the variants do not write what is buffered again
+void TraceWriter::Suspend() {
+    if(file != nullptr) {
+        Flush();
+        fflush(file);
+    }
+}
+
+void TraceWriter::Resume(unsigned variant) {
+    if(file == nullptr || variant == 0) {
+        return;
+    }
+    fclose(file);
+    Open(path + "." + to_string(variant));
+}
+
+void TraceWriter::Counter(MachineId_t machine_id, const char * name, unsigned value) {
+    Begin("C", machine_id);
+    Append(",\"name\":\"");
+    Append(name);
+    Append("\",\"args\":{\"value\":");
+    Append(value);
+    Append("}");
+    End();
+}
+
+// The flow of a migration starts within the migration slice at the source and binds
+// to the first slice of the VM where it lands
+void TraceWriter::Flow(char phase, VMId_t vm_id, MachineId_t machine_id) {
+    const char name[2] = {phase, '\0'};
+    Begin(name, machine_id);
+    Append(",\"tid\":");
+    Append(vm_id);
+    Append(",\"cat\":\"migration\",\"name\":\"migration\",\"id\":");
+    Append(vm_id);
+    if(phase == 'f') {
+        Append(",\"bp\":\"e\"");
+    }
+    End();
+}
+
+void TraceWriter::Instant(TaskId_t task_id, const char * name) {
+    const Placement_t & placement = tasks[task_id];
+    Begin("i", placement.machine_id);
+    Append(",\"tid\":");
+    Append(placement.vm_id);
+    Append(",\"s\":\"t\",\"name\":\"");
+    Append(name);
+    Append("\",\"args\":{\"task\":");
+    Append(task_id);
+    Append("}");
+    End();
+}
+
+void TraceWriter::Slice(const char * name, const char * category, MachineId_t machine_id, VMId_t vm_id, Time_t start, Time_t end, TaskId_t task_id) {
+    Append(first ? "[\n{\"ph\":\"X\",\"ts\":" : ",\n{\"ph\":\"X\",\"ts\":");
+    first = false;
+    Append(start);
+    Append(",\"dur\":");
+    Append(end - start);
+    Append(",\"pid\":");
+    Append(machine_id);
+    Append(",\"tid\":");
+    Append(vm_id);
+    Append(",\"cat\":\"");
+    Append(category);
+    Append("\",\"name\":\"");
+    Append(name);
+    Append("\",\"args\":{\"task\":");
+    Append(task_id);
+    Append("}");
+    End();
+}
+
+void TraceWriter::TaskStarted(TaskId_t task_id, VMId_t vm_id, MachineId_t machine_id) {
+    tasks[task_id] = {Now(), machine_id, vm_id};
+}
+
+void TraceWriter::TaskStopped(TaskId_t task_id) {
+    static const char * names[NUM_SLAS] = {"SLA0", "SLA1", "SLA2", "SLA3"};
+    Placement_t & placement = tasks[task_id];
+    if(placement.start == NEVER_STARTED) {
+        return;
+    }
+    Slice(names[RequiredSLA(task_id)], "task", placement.machine_id, placement.vm_id, placement.start, Now(), task_id);
+    placement.start = NEVER_STARTED;
+}
+
+void Trace_Start() {
+    trace.Start();
+}
+
+void Trace_Stop() {
+    trace.Stop();
+}
+
+void Trace_Suspend() {
+    trace.Suspend();
+}
+
+void Trace_Resume(unsigned variant) {
+    trace.Resume(variant);
+}
+
+void Trace_TaskAttached(TaskId_t task_id, VMId_t vm_id, MachineId_t machine_id) {
+    if(trace.Enabled()) {
+        trace.TaskStarted(task_id, vm_id, machine_id);
+    }
+}
+
+void Trace_TaskCompleted(TaskId_t task_id, bool violated) {
+    if(trace.Enabled()) {
+        trace.TaskStopped(task_id);
+        if(violated) {
+            trace.Instant(task_id, "SLA warning");
+        }
+    }
+}
+
+void Trace_MigrationStarted(VMId_t vm_id, MachineId_t machine_id) {
+    if(!trace.Enabled()) {
+        return;
+    }
+    for(TaskId_t task_id : VM_GetInfoRef(vm_id).active_tasks) {
+        trace.TaskStopped(task_id);
+    }
+    trace.Slice("migration", "migration", machine_id, vm_id, Now(), Now() + MIGRATION_LATENCY, 0);
+    trace.Flow('s', vm_id, machine_id);
+}
+
+void Trace_MigrationCompleted(VMId_t vm_id, MachineId_t machine_id) {
+    if(trace.Enabled()) {
+        trace.Flow('f', vm_id, machine_id);
+    }
+}
+
+void Trace_SState(MachineId_t machine_id, MachineState_t s_state) {
+    if(trace.Enabled()) {
+        trace.Counter(machine_id, "S-state", s_state);
+    }
+}
+
+void Trace_PState(MachineId_t machine_id, CPUPerformance_t p_state) {
+    if(trace.Enabled()) {
+        trace.Counter(machine_id, "P-state", p_state);
+    }
+}
@@ -0,0 +1,234 @@
+//
+//  VM.cpp
+//  CloudSim
+//
+//  Created by ELMOOTAZBELLAH ELNOZAHY on 10/20/24.
+//
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Interfaces.h"
+#include "Internal_Interfaces.h"
+
+typedef enum {
+    VM_CREATED,             // Not attached to a machine yet
+    VM_RUNNING,
+    VM_PENDING_MIGRATION,   // Migration requested, waiting for the machine to let go of the VM
+    VM_MIGRATING,
+    VM_SHUTDOWN
+} VMState_t;
+
+class VM {
+public:
+    VM(VMType_t vm_type, CPUType_t cpu, VMId_t id);
+    void            AddTask(TaskId_t task_id, Priority_t priority);
+    void            Attach(MachineId_t machine_id);
+    const VMInfo_t & GetVMInfo()            { return info; }
+    unsigned        GetMemoryFootprint()    { return VM_MEMORY_OVERHEAD + task_memory; }
+    bool            IsPendingMigration()    { return state == VM_PENDING_MIGRATION; }
+    void            Migrate(MachineId_t machine_id);
+    void            MigrationDone();
+    void            MigrationStarted();
+    void            RemoveTask(TaskId_t task_id);
+    void            Shutdown();
+private:
+    VMInfo_t        info;               // active_tasks is kept sorted, VM_GetInfo() reports the tasks in id order
+    MachineId_t     target_machine;     // Destination of a pending or ongoing migration
+    VMState_t       state;
+    unsigned        task_memory;        // Sum of the memory needed by the active tasks
+};
+
+// A deque so VM_Create() never moves the VMs that VM_GetInfoRef() handed out
+static deque<VM>    VMs;
+static VMId_t       VMId_gen = 0;
+
+VM::VM(VMType_t vm_type, CPUType_t cpu, VMId_t id) : target_machine(0), state(VM_CREATED), task_memory(0) {
+    info.cpu = cpu;
+    info.machine_id = 0;
+    info.vm_id = id;
+    info.vm_type = vm_type;
+    if(vm_type == AIX && cpu != POWER) {
+        ThrowException("VM::VM(): Creating an AIX virtual machine on an inapporpriate CPU");
+    }
+    if(vm_type == WIN && (cpu == RISCV || cpu == POWER)) {
+        ThrowException("VM::VM(): Creating Windows virtual machine on an inapporpriate CPU");
+    }
+}
+
+void VM::AddTask(TaskId_t task_id, Priority_t priority) {
+    if(state != VM_RUNNING) {
+        ThrowException("VM::AddTask(): Adding a task to a VM that is not ready (either not allocated to a machine or migrating");
+    }
+    if(RequiredCPUType(task_id) != info.cpu) {
+        ThrowException("VM::AddTask(): Adding a task to a VM with incompatible CPU");
+    }
+    auto position = lower_bound(info.active_tasks.begin(), info.active_tasks.end(), task_id);
+    if(position == info.active_tasks.end() || *position != task_id) {
+        info.active_tasks.insert(position, task_id);
+        task_memory += GetTaskMemory(task_id);
+    }
+    SetTaskPriority(task_id, priority);
+    Machine_AttachTask(info.machine_id, task_id, info.vm_id);
+    if(Machine_CheckMemoryOverflow(info.machine_id)) {
+        MemoryWarning(Now(), info.machine_id);
+    }
+}
+
+void VM::Attach(MachineId_t machine_id) {
+    if(state != VM_CREATED) {
+        ThrowException("VM::Attach(): Attaching a VM to a machine while the VM is already running");
+    }
+    SimOutput("The CPU is " + to_string(int(info.cpu)) + " and the machine's CPU is " + to_string(int(Machine_GetCPUType(machine_id))), 4);
+    if(Machine_GetCPUType(machine_id) != info.cpu) {
+        ThrowException("VM::Attach(): Attaching a VM to a machine with incompatible CPU");
+    }
+    state = VM_RUNNING;
+    info.machine_id = machine_id;
+    Machine_AttachVM(machine_id, info.vm_id);
+    if(Machine_CheckMemoryOverflow(machine_id)) {
+        MemoryWarning(Now(), machine_id);
+    }
+}
+
+void VM::Migrate(MachineId_t machine_id) {
+    if(state != VM_RUNNING) {
+        ThrowException("VM::Migrate(): Incorrect VM migration request");
+    }
+    if(Machine_GetCPUType(machine_id) != info.cpu) {
+        ThrowException("VM::Migrate(): Attaching a VM to a machine with incompatible CPU");
+    }
+    SimOutput("VM::Migrate(): Migration starting for VM " + to_string(info.vm_id) + " from machine " + to_string(info.machine_id) + " to machine " + to_string(machine_id), 4);
+    SimOutput("VM::Migrate(): Number of tasks " + to_string(info.active_tasks.size()), 4);
+    target_machine = machine_id;
+    state = VM_PENDING_MIGRATION;
+    Machine_MigrateVM(info.vm_id, info.machine_id, target_machine);
+}
+
+void VM::MigrationDone() {
+    if(state != VM_MIGRATING) {
+        ThrowException("VM::MigrationDone(): Report of a migration completion to a VM that was not migrating!");
+    }
+    state = VM_RUNNING;
+    info.machine_id = target_machine;
+    Trace_MigrationCompleted(info.vm_id, info.machine_id);
+    Machine_AttachVM(info.machine_id, info.vm_id);
+    for(TaskId_t task_id : info.active_tasks) {
+        Machine_AttachTask(info.machine_id, task_id, info.vm_id);
+    }
+    if(Machine_CheckMemoryOverflow(info.machine_id)) {
+        MemoryWarning(Now(), info.machine_id);
+    }
+}
+
+void VM::MigrationStarted() {
+    if(state != VM_PENDING_MIGRATION) {
+        ThrowException("VM::MigrationStarted(): Report of a migration start to a VM that was not pending migration!");
+    }
+    state = VM_MIGRATING;
+}
+
+void VM::RemoveTask(TaskId_t task_id) {
+    if(state != VM_RUNNING && state != VM_PENDING_MIGRATION) {
+        ThrowException("VM::RemoveTask(): Removing a task from an inactive or migrating VM");
+    }
+    auto position = lower_bound(info.active_tasks.begin(), info.active_tasks.end(), task_id);
+    if(position == info.active_tasks.end() || *position != task_id) {
+        ThrowException("VM::RemoveTask(): VM is asked to remove a non existent task", task_id);
+    }
+    info.active_tasks.erase(position);
+    task_memory -= GetTaskMemory(task_id);
+    SimOutput("VM::RemoveTask(): Removed task " + to_string(task_id) + " from VM " + to_string(info.vm_id), 4);
+}
+
+void VM::Shutdown() {
+    if(state != VM_RUNNING) {
+        ThrowException("VM::Shutdown(): Shutting down an inactive VM");
+    }
+    if(!info.active_tasks.empty()) {
+        ThrowException("VM::Shutdown(): Shutting down a VM while tasks are still running--likely a bug");
+    }
+    state = VM_SHUTDOWN;
+    Machine_DetachVM(info.machine_id, info.vm_id);
+}
+
+static void ValidateVMId(VMId_t vm_id, const char * caller) {
+    if(vm_id >= VMs.size()) {
+        ThrowException(string(caller) + "(): Bad VM identifier " + to_string(vm_id));
+    }
+}
+
+// Public interface below
+
+void VM_Attach(VMId_t vm_id, MachineId_t machine_id) {
+    ValidateVMId(vm_id, "VM_Attach");
+    VMs[vm_id].Attach(machine_id);
+}
+
+void VM_AddTask(VMId_t vm_id, TaskId_t task_id, Priority_t priority) {
+    ValidateVMId(vm_id, "VM_AddTask");
+    VMs[vm_id].AddTask(task_id, priority);
+}
+
+VMId_t VM_Create(VMType_t vm_type, CPUType_t cpu) {
+    VMId_t vm_id = VMId_gen++;
+    VMs.push_back(VM(vm_type, cpu, vm_id));
+    return vm_id;
+}
+
+VMInfo_t VM_GetInfo(VMId_t vm_id) {
+    ValidateVMId(vm_id, "VM_GetInfo");
+    return VMs[vm_id].GetVMInfo();
+}
+
+const VMInfo_t & VM_GetInfoRef(VMId_t vm_id) {
+    ValidateVMId(vm_id, "VM_GetInfoRef");
+    return VMs[vm_id].GetVMInfo();
+}
+
+unsigned VM_GetMemoryFootprint(VMId_t vm_id) {
+    ValidateVMId(vm_id, "VM_GetMemoryFootprint");
+    return VMs[vm_id].GetMemoryFootprint();
+}
+
+unsigned VM_GetTaskCount(VMId_t vm_id) {
+    ValidateVMId(vm_id, "VM_GetTaskCount");
+    return unsigned(VMs[vm_id].GetVMInfo().active_tasks.size());
+}
+
+void VM_Migrate(VMId_t vm_id, MachineId_t machine_id) {
+    ValidateVMId(vm_id, "VM_Migrate");
+    SimOutput("VM_Migrate(): Migration of VM " + to_string(vm_id) + " to " + to_string(machine_id) + " starting at time " + to_string(Now()), 4);
+    VMs[vm_id].Migrate(machine_id);
+}
+
+void VM_RemoveTask(VMId_t vm_id, TaskId_t task_id) {
+    ValidateVMId(vm_id, "VM_RemoveTask");
+    SimOutput("VM_RemoveTask(): Removing task " + to_string(task_id) + " from VM " + to_string(vm_id), 4);
+    VMs[vm_id].RemoveTask(task_id);
+}
+
+void VM_Shutdown(VMId_t vm_id) {
+    ValidateVMId(vm_id, "VM_Shutdown");
+    VMs[vm_id].Shutdown();
+}
+
+// Internal interface below
+
+bool VM_IsPendingMigration(VMId_t vm_id) {
+    ValidateVMId(vm_id, "VM_IsPendingMigration");
+    return VMs[vm_id].IsPendingMigration();
+}
+
+void VM_MigrationCompleted(VMId_t vm_id) {
+    ValidateVMId(vm_id, "VM_MigrationCompleted");
+    VMs[vm_id].MigrationDone();
+    MigrationDone(Now(), vm_id);
+}
+
+void VM_MigrationStarted(VMId_t vm_id) {
+    ValidateVMId(vm_id, "VM_MigrationStarted");
+    VMs[vm_id].MigrationStarted();
+}
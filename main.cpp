@@ -0,0 +1,73 @@
+//
+//  main.cpp
+//  CloudSim
+//
+//  Created by ELMOOTAZBELLAH ELNOZAHY on 10/20/24.
+//
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string>
+
+#include "Interfaces.h"
+#include "Internal_Interfaces.h"
+
+static unsigned verbose_level = 0;
+
+void SimOutput(string msg, unsigned level) {
+    if(level <= verbose_level) {
+        cout << msg << endl;
+    }
+}
+
+bool SimVerbose(unsigned level) {
+    return level <= verbose_level;
+}
+
+void ThrowException(string err_msg) {
+    throw runtime_error(err_msg);
+}
+
+void ThrowException(string err_msg, string further_input) {
+    throw runtime_error(err_msg + further_input);
+}
+
+void ThrowException(string err_msg, unsigned further_input) {
+    stringstream ss;
+    ss << err_msg << further_input;
+    throw runtime_error(ss.str());
+}
+
+int main(int argc, char * argv[]) {
+    try {
+        switch(argc) {
+            case 1:
+                verbose_level = 0;
+                Init("/tmp/Input");
+                break;
+            case 2:
+                verbose_level = 0;
+                Init(argv[1]);
+                break;
+            case 4:
+                if(string(argv[1]) == "-v") {
+                    verbose_level = atoi(argv[2]);
+                    Init(argv[3]);
+                    break;
+                }
+                ThrowException(string("Usage ") + argv[0] + "[-v] input_file");
+                break;
+            default:
+                ThrowException(string("Usage ") + argv[0] + "[-v] input_file");
+        }
+    }
+    catch(runtime_error & e) {
+        cerr << "Caught an exception!" << endl;
+        cerr << e.what() << endl;
+        cerr << "Bailing out!" << endl;
+        return -1;
+    }
+    return 0;
+}